@@ -17,7 +17,8 @@ SOLVERS_9 = [
     "build/sudoku_serial",
     "build/sudoku_omp",
     "build/sudoku_simd",
-    "build/sudoku_omp_simd"
+    "build/sudoku_omp_simd",
+    "build/sudoku_dlx"
 ]
 
 # 16x16 Solvers
@@ -25,7 +26,8 @@ SOLVERS_16 = [
     "build/sudoku_serial_16",
     "build/sudoku_omp_16",
     "build/sudoku_simd_16",
-    "build/sudoku_omp_simd_16"
+    "build/sudoku_omp_simd_16",
+    "build/sudoku_dlx_16"
 ]
 
 DIFFICULTIES_9 = {
@@ -136,7 +138,7 @@ def run_benchmark(size_name, base, difficulties, solvers):
             
             for solver in solvers:
                 # If serial, only run with 1 thread (conceptually)
-                is_serial = "serial" in solver or "simd" in solver and "omp" not in solver
+                is_serial = "serial" in solver or "dlx" in solver or "simd" in solver and "omp" not in solver
                 
                 test_threads = [1] if is_serial else THREADS_TO_TEST
                 
@@ -158,7 +160,7 @@ def run_benchmark(size_name, base, difficulties, solvers):
         best_thread = -1
         
         for solver in solvers:
-            is_serial = "serial" in solver or "simd" in solver and "omp" not in solver
+            is_serial = "serial" in solver or "dlx" in solver or "simd" in solver and "omp" not in solver
             test_threads = [1] if is_serial else THREADS_TO_TEST
             
             for t in test_threads:
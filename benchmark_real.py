@@ -16,7 +16,8 @@ SOLVERS = [
     "build/sudoku_serial",
     "build/sudoku_omp",
     "build/sudoku_simd",
-    "build/sudoku_omp_simd"
+    "build/sudoku_omp_simd",
+    "build/sudoku_dlx"
 ]
 
 THREADS_TO_TEST = [1, 2, 4, 8, 12, 16, 24]
@@ -78,7 +79,7 @@ def main():
                 if solver not in results[diff]:
                     results[diff][solver] = {}
 
-                is_serial = "serial" in solver or ("simd" in solver and "omp" not in solver)
+                is_serial = "serial" in solver or "dlx" in solver or ("simd" in solver and "omp" not in solver)
                 test_threads = [1] if is_serial else THREADS_TO_TEST
                 
                 for t in test_threads:
@@ -95,7 +96,7 @@ def main():
 
     for diff in difficulties:
         for solver in SOLVERS:
-            is_serial = "serial" in solver or ("simd" in solver and "omp" not in solver)
+            is_serial = "serial" in solver or "dlx" in solver or ("simd" in solver and "omp" not in solver)
             test_threads = [1] if is_serial else THREADS_TO_TEST
             
             for t in test_threads:
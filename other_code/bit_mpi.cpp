@@ -6,6 +6,14 @@
 #include <chrono>
 #include <mpi.h>
 #include <iomanip>
+#include <list>
+#include <deque>
+#include <algorithm>
+#include <cctype>
+#include "frontier.h"
+#include "mrv_buckets.h"
+#include <sched.h>
+#include <cstdlib>
 
 using namespace std;
 
@@ -14,10 +22,23 @@ int SIZE;
 int BLOCK_SIZE;
 
 // MPI 訊息標籤
-#define TAG_TASK      1   // Master -> Worker: 傳一個起始狀態 (grid)
-#define TAG_SOLUTION  2   // Worker -> Master: 回傳解
-#define TAG_DONE      3   // Worker -> Master: 該 task 無解，要求下一個
-#define TAG_TERMINATE 4   // Master -> Worker: 結束
+// 所有 rank 都是對等的 worker：閒置的 rank 向隨機的 peer 要工作，
+// 被要求的 rank 把自己最淺層尚未嘗試的分支切給它 (lazy splitting)。
+// 結束偵測用 Dijkstra 的 token ring，master 只負責發起 token 與廣播結束。
+#define TAG_WORK      1   // 被偷的 rank -> 要工作的 rank: 一個子問題 (見 TaskHeader)
+#define TAG_SOLUTION  2   // 找到解的 rank -> rank 0: 解
+#define TAG_STEAL     3   // 閒置的 rank -> 隨機 peer: 要求工作
+#define TAG_NO_WORK   4   // peer -> 閒置的 rank: 沒有可以切的分支
+#define TAG_TOKEN     5   // rank i -> rank i+1: 結束偵測 token (顏色)
+#define TAG_TERMINATE 6   // rank 0 -> 所有 rank: 結束
+
+#define POLL_INTERVAL 64  // 每展開幾個節點檢查一次訊息
+
+// 批次模式 (--batch) 的標籤，與單題模式不會同時使用
+#define TAG_BATCH        7   // rank 0 -> worker: 一批打包好的題目
+#define TAG_BATCH_RESULT 8   // worker -> rank 0: 同一批的解
+#define TAG_BATCH_END    9   // rank 0 -> worker: 沒有更多題目
+#define BATCH_DEPTH      3   // 每個 worker 同時持有的批次數
 
 // --- 輔助函數 ---
 inline int getBox(int row, int col) {
@@ -37,6 +58,7 @@ struct SolverState {
     unsigned long long rowMask[25];
     unsigned long long colMask[25];
     unsigned long long boxMask[25];
+    MrvBuckets buckets;
 
     void init(const int* input_grid) {
         memcpy(grid, input_grid, SIZE * SIZE * sizeof(int));
@@ -55,210 +77,627 @@ struct SolverState {
                 }
             }
         }
+        mrv_init(*this);
     }
 };
 
-// --- 回溯 ---
-bool solve_recursive(SolverState& state) {
-    int row = -1, col = -1;
-    int minCount = SIZE + 1;
+// --- MRV ---
+// 回傳 false 表示有空格無候選數 (矛盾)；row == -1 表示盤面已填滿。
+// 空格依候選數分桶 (mrv_buckets.h)，不必每個節點掃過全盤。
+bool pick_cell(const SolverState& state, int& row, int& col, unsigned long long& candidates) {
+    return mrv_pick(state, row, col, candidates);
+}
+
+inline void set_cell(SolverState& s, int row, int col, int num) {
+    mrv_set(s, row, col, num);
+}
+
+inline void clear_cell(SolverState& s, int row, int col) {
+    mrv_clear(s, row, col);
+}
+
+// --- 子問題的訊息格式 ---
+// TAG_WORK 的內容是 TaskHeader 後面接 SIZE*SIZE 個 int 的盤面。
+// row == -1：從這個盤面開始完整搜尋；否則 (row, col) 是空格，
+// 只需嘗試 rest 裡的數字。
+struct TaskHeader {
+    int row, col;
+    unsigned int rest_lo, rest_hi;
+};
 
-    // MRV：選一個候選數最少的空格
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (state.grid[i * SIZE + j] == 0) {
-                unsigned long long used =
-                    state.rowMask[i] | state.colMask[j] | state.boxMask[getBox(i, j)];
+const int HEADER_INTS = sizeof(TaskHeader) / sizeof(int);
 
-                unsigned long long available =
-                    ((1ULL << (SIZE + 1)) - 2) & ~used;     // bits 1..SIZE
+// --- 可被切割的 DFS ---
+// 用明確的堆疊取代遞迴，才能在搜尋途中把淺層尚未嘗試的數字交給別人。
+// frames[d] 是第 d 層的分支：格子、目前填入的數字、還沒試過的數字。
+struct Frame {
+    int row, col;
+    unsigned long long rest;
+};
 
-                int count = __builtin_popcountll(available);
-                if (count == 0) return false;
+struct Search {
+    SolverState state;
+    Frame frames[25 * 25];
+    int depth = 0;
+    bool expand = false;    // 下一步要展開目前盤面 (新節點)
+    bool active = false;    // 手上有工作
+    long long nodes = 0;
+
+    void start(const TaskHeader& h, const int* grid) {
+        state.init(grid);
+        depth = 0;
+        expand = true;
+        active = true;
+        if (h.row != -1) {
+            unsigned long long rest = h.rest_lo | ((unsigned long long)h.rest_hi << 32);
+            frames[depth++] = Frame{h.row, h.col, rest};
+            expand = false;
+        }
+    }
 
-                if (count < minCount) {
-                    minCount = count;
-                    row = i;
-                    col = j;
+    // 最多展開 budget 個節點；回傳 true 表示找到解 (解在 state)
+    bool run(int budget) {
+        while (active && budget > 0) {
+            if (expand) {
+                budget--;
+                nodes++;
+                int row, col;
+                unsigned long long candidates = 0;
+                if (pick_cell(state, row, col, candidates)) {
+                    if (row == -1) return true;
+                    frames[depth++] = Frame{row, col, candidates};
                 }
             }
+
+            // 回溯到還有數字可試的一層，換下一個數字
+            while (depth > 0 && frames[depth - 1].rest == 0) {
+                Frame& f = frames[--depth];
+                if (state.grid[f.row * SIZE + f.col] != 0) clear_cell(state, f.row, f.col);
+            }
+            if (depth == 0) {
+                active = false;
+                break;
+            }
+            Frame& f = frames[depth - 1];
+            if (state.grid[f.row * SIZE + f.col] != 0) clear_cell(state, f.row, f.col);
+            int num = __builtin_ctzll(f.rest);
+            f.rest &= f.rest - 1;
+            set_cell(state, f.row, f.col, num);
+            expand = true;
         }
+        return false;
     }
 
-    // 沒空格了 → solved
-    if (row == -1) return true;
+    // 把最淺層 (子樹最大) 尚未嘗試的數字切出去：盤面是目前盤面去掉
+    // 該層以下填入的格子。沒有可切的分支時回傳 false。
+    bool split(vector<int>& msg) {
+        int d = 0;
+        while (d < depth && frames[d].rest == 0) d++;
+        if (d == depth) return false;
+
+        msg.assign(HEADER_INTS + SIZE * SIZE, 0);
+        TaskHeader h{frames[d].row, frames[d].col,
+                     (unsigned int)frames[d].rest, (unsigned int)(frames[d].rest >> 32)};
+        memcpy(msg.data(), &h, sizeof(h));
+        int* grid = msg.data() + HEADER_INTS;
+        memcpy(grid, state.grid, SIZE * SIZE * sizeof(int));
+        for (int k = d; k < depth; k++) grid[frames[k].row * SIZE + frames[k].col] = 0;
+        frames[d].rest = 0;
+        return true;
+    }
+};
 
-    unsigned long long used =
-        state.rowMask[row] | state.colMask[col] | state.boxMask[getBox(row, col)];
-    unsigned long long available =
-        ((1ULL << (SIZE + 1)) - 2) & ~used;
+// --- 每個 rank 的工作迴圈 ---
+// 送出的訊息一律用 MPI_Isend，接收端永遠在輪詢，所以不會互相卡住；
+// 結束時先等自己的送出完成，再用 MPI_Ibarrier 確認大家都停下來了。
+class Worker {
+public:
+    Worker(int rank, int nprocs) : rank(rank), nprocs(nprocs), seed(rank * 7919 + 1) {}
+
+    // 回傳 true 表示找到解；只有 rank 0 的 solution 有意義
+    bool run(const int* initial_grid, int* solution) {
+        // 每個 rank 都以廣度優先展開出同一個前緣，各自拿第 rank, rank+nprocs, ...
+        // 個子問題，不需要任何訊息；之後的不平衡由偷工作補上
+        Frontier frontier = FrontierBuilder(SIZE, BLOCK_SIZE).build(initial_grid, FRONTIER_PER_WORKER * nprocs);
+        if (frontier.solved) {
+            memcpy(solution, frontier.solution.grid, SIZE * SIZE * sizeof(int));
+            return true;
+        }
+        for (int i = rank; i < (int)frontier.nodes.size(); i += nprocs) local.push_back(frontier.nodes[i]);
 
-    int box = getBox(row, col);
+        while (!terminated) {
+            if (!search.active && !stopped && !local.empty()) {
+                TaskHeader root{-1, -1, 0, 0};
+                search.start(root, local.front().grid);
+                local.pop_front();
+            }
+            if (search.active) {
+                if (search.run(POLL_INTERVAL)) found_solution();
+            } else if (!stopped && !asking && nprocs > 1) {
+                int peer = (rank + 1 + rand_r(&seed) % (nprocs - 1)) % nprocs;
+                post(peer, TAG_STEAL, vector<int>());
+                asking = true;
+            }
+            poll();
+            if (!search.active && local.empty()) {
+                pass_token();
+                if (!terminated) sched_yield();
+            }
+        }
 
-    while (available) {
-        unsigned long long bit = available & -available;
-        available ^= bit;
+        if (found) memcpy(solution, solution_grid.data(), SIZE * SIZE * sizeof(int));
+        return found;
+    }
 
-        int num = __builtin_ctzll(bit);
+    // run 之後呼叫：等自己送出的訊息完成，再等所有 rank 都停下來
+    void shutdown() {
+        vector<int> buf(HEADER_INTS + SIZE * SIZE);
+        MPI_Request barrier = MPI_REQUEST_NULL;
+        bool in_barrier = false;
+        while (true) {
+            int flag = 0;
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+            if (flag) {
+                MPI_Recv(buf.data(), (int)buf.size(), MPI_INT, status.MPI_SOURCE, status.MPI_TAG,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                continue;
+            }
+            if (!in_barrier) {
+                reap_sends();
+                if (pending.empty()) {
+                    MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+                    in_barrier = true;
+                }
+            } else {
+                int done = 0;
+                MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+                if (done) break;
+            }
+            sched_yield();
+        }
+    }
 
-        state.grid[row * SIZE + col] = num;
-        state.rowMask[row] |= bit;
-        state.colMask[col] |= bit;
-        state.boxMask[box] |= bit;
+    void print_stats() const {
+        cerr << "rank " << rank << ": nodes=" << search.nodes << " tasks=" << tasks_received
+             << " donated=" << tasks_donated << endl;
+    }
 
-        if (solve_recursive(state)) return true;
+private:
+    struct PendingSend {
+        vector<int> buf;
+        MPI_Request req;
+    };
 
-        // 回溯
-        state.grid[row * SIZE + col] = 0;
-        state.rowMask[row] ^= bit;
-        state.colMask[col] ^= bit;
-        state.boxMask[box] ^= bit;
+    int rank, nprocs;
+    unsigned int seed;
+    Search search;
+    deque<FrontierNode> local; // 分到但還沒開始的前緣子問題
+    bool asking = false;       // 已送出 TAG_STEAL，還在等回覆
+    bool stopped = false;      // 已找到解，等待結束
+    bool terminated = false;
+    bool found = false;
+    vector<int> solution_grid;
+    long long tasks_received = 0;
+    long long tasks_donated = 0;
+    list<PendingSend> pending;
+
+    // token ring：black 表示上次 token 經過之後送出過工作
+    bool black = false;
+    bool has_token = false;
+    bool token_black = false;
+    bool token_out = false;    // rank 0：token 正在環上
+
+    void post(int dest, int tag, vector<int> buf) {
+        pending.push_back(PendingSend{std::move(buf), MPI_REQUEST_NULL});
+        PendingSend& p = pending.back();
+        MPI_Isend(p.buf.data(), (int)p.buf.size(), MPI_INT, dest, tag, MPI_COMM_WORLD, &p.req);
+        reap_sends();
     }
 
-    return false;
-}
+    // 回收已完成的送出
+    void reap_sends() {
+        for (auto it = pending.begin(); it != pending.end();) {
+            int done = 0;
+            MPI_Test(&it->req, &done, MPI_STATUS_IGNORE);
+            if (done) it = pending.erase(it);
+            else ++it;
+        }
+    }
 
-// --- Master：負責切第一層分支 + 分配 tasks 給 workers ---
-bool master_process(int num_workers, const int* initial_grid, int* final_solution) {
-    SolverState temp;
-    temp.init(initial_grid);
+    void broadcast_terminate() {
+        for (int r = 1; r < nprocs; r++) post(r, TAG_TERMINATE, vector<int>());
+        terminated = true;
+    }
 
-    // 找一個空格（這裡可以用 MRV，也可以直接找第一個）
-    int row = -1, col = -1;
-    for (int i = 0; i < SIZE * SIZE; i++) {
-        if (temp.grid[i] == 0) {
-            row = i / SIZE;
-            col = i % SIZE;
-            break;
+    void found_solution() {
+        search.active = false;
+        stopped = true;
+        vector<int> grid(search.state.grid, search.state.grid + SIZE * SIZE);
+        if (rank == 0) {
+            solution_grid = grid;
+            found = true;
+            broadcast_terminate();
+        } else {
+            post(0, TAG_SOLUTION, grid);
         }
     }
 
-    // 沒有空格 → 已經 solved
-    if (row == -1) {
-        memcpy(final_solution, initial_grid, SIZE * SIZE * sizeof(int));
-        return true;
+    // 處理目前所有已到達的訊息
+    void poll() {
+        vector<int> buf(HEADER_INTS + SIZE * SIZE);
+        int flag = 1;
+        while (!terminated) {
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+            if (!flag) break;
+            MPI_Recv(buf.data(), (int)buf.size(), MPI_INT, status.MPI_SOURCE, status.MPI_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            int src = status.MPI_SOURCE;
+
+            switch (status.MPI_TAG) {
+            case TAG_STEAL: {
+                vector<int> msg;
+                if (!local.empty()) {
+                    // 還沒開始的前緣子問題整個交出去
+                    TaskHeader h{-1, -1, 0, 0};
+                    msg.assign(HEADER_INTS + SIZE * SIZE, 0);
+                    memcpy(msg.data(), &h, sizeof(h));
+                    memcpy(msg.data() + HEADER_INTS, local.back().grid, SIZE * SIZE * sizeof(int));
+                    local.pop_back();
+                    black = true;
+                    tasks_donated++;
+                    post(src, TAG_WORK, std::move(msg));
+                } else if (search.active && search.split(msg)) {
+                    black = true;
+                    tasks_donated++;
+                    post(src, TAG_WORK, std::move(msg));
+                } else {
+                    post(src, TAG_NO_WORK, vector<int>());
+                }
+                break;
+            }
+            case TAG_WORK: {
+                TaskHeader h;
+                memcpy(&h, buf.data(), sizeof(h));
+                asking = false;
+                if (!stopped) {
+                    search.start(h, buf.data() + HEADER_INTS);
+                    tasks_received++;
+                }
+                break;
+            }
+            case TAG_NO_WORK:
+                asking = false;
+                break;
+            case TAG_TOKEN:
+                has_token = true;
+                token_black = buf[0] != 0;
+                break;
+            case TAG_SOLUTION:
+                // 只有 rank 0 會收到
+                if (!found) {
+                    solution_grid.assign(buf.begin(), buf.begin() + SIZE * SIZE);
+                    found = true;
+                    broadcast_terminate();
+                }
+                break;
+            case TAG_TERMINATE:
+                terminated = true;
+                break;
+            }
+        }
     }
 
-    // 該格的候選數字
-    unsigned long long used =
-        temp.rowMask[row] | temp.colMask[col] | temp.boxMask[getBox(row, col)];
-    unsigned long long available =
-        ((1ULL << (SIZE + 1)) - 2) & ~used;
+    // 閒置時處理 token。找到解的 rank 不傳 token，避免 rank 0 在收到
+    // 解之前就判斷為無解。
+    void pass_token() {
+        if (terminated || stopped) return;
+        if (nprocs == 1) {
+            terminated = true;   // 只有一個 rank，閒置就是搜尋結束
+            return;
+        }
+        if (rank == 0) {
+            if (has_token) {
+                has_token = false;
+                token_out = false;
+                if (!token_black && !black) {
+                    broadcast_terminate();   // 整圈都閒置且沒有送出過工作
+                    return;
+                }
+            }
+            if (!token_out) {
+                black = false;
+                token_out = true;
+                post(1, TAG_TOKEN, vector<int>(1, 0));
+            }
+        } else if (has_token) {
+            has_token = false;
+            post((rank + 1) % nprocs, TAG_TOKEN, vector<int>(1, (token_black || black) ? 1 : 0));
+            black = false;
+        }
+    }
+};
 
-    vector<SolverState> tasks;
-    while (available) {
-        unsigned long long bit = available & -available;
-        available ^= bit;
-        int num = __builtin_ctzll(bit);
+// --- 批次模式 (Batch Mode) ---
+// 大量題目時，把很多題打包成一個訊息，以 byte 為單位傳送：
+// SIZE < 16 時每格 4 bits (兩格一個 byte，9x9 是 41 bytes 而非 324)，
+// 否則每格 1 byte。解用同樣的格式送回，全 0 的盤面代表無解。
+//
+// rank 0 只負責分派：一開始給每個 worker BATCH_DEPTH 批，之後 worker 每回傳
+// 一批就立刻補一批，所以 worker 手上永遠還有下一批可做。worker 一直掛著一個
+// MPI_Irecv 接收下一批，解完的結果用 MPI_Isend 送出，計算與通訊重疊。
+
+struct BatchHeader {
+    int id;       // 第幾批
+    int count;    // 這批有幾題
+};
 
-        SolverState s = temp;
-        int box = getBox(row, col);
+inline int packed_bytes() {
+    return SIZE < 16 ? (SIZE * SIZE + 1) / 2 : SIZE * SIZE;
+}
+
+void pack_grid(const int* grid, unsigned char* out) {
+    if (SIZE < 16) {
+        memset(out, 0, packed_bytes());
+        for (int i = 0; i < SIZE * SIZE; i++) out[i / 2] |= (unsigned char)(grid[i] << ((i & 1) * 4));
+    } else {
+        for (int i = 0; i < SIZE * SIZE; i++) out[i] = (unsigned char)grid[i];
+    }
+}
+
+void unpack_grid(const unsigned char* in, int* grid) {
+    if (SIZE < 16) {
+        for (int i = 0; i < SIZE * SIZE; i++) grid[i] = (in[i / 2] >> ((i & 1) * 4)) & 0xF;
+    } else {
+        for (int i = 0; i < SIZE * SIZE; i++) grid[i] = in[i];
+    }
+}
 
-        s.grid[row * SIZE + col] = num;
-        s.rowMask[row] |= bit;
-        s.colMask[col] |= bit;
-        s.boxMask[box] |= bit;
+inline char numToChar(int v) {
+    return v < 10 ? (char)('0' + v) : (char)('A' + v - 10);
+}
 
-        tasks.push_back(s);
+// 序列解一題；無解時 solution 全為 0
+bool solve_one(const int* grid, int* solution) {
+    Search search;
+    TaskHeader root{-1, -1, 0, 0};
+    search.start(root, grid);
+    while (search.active) {
+        if (search.run(1 << 20)) {
+            memcpy(solution, search.state.grid, SIZE * SIZE * sizeof(int));
+            return true;
+        }
     }
+    memset(solution, 0, SIZE * SIZE * sizeof(int));
+    return false;
+}
 
-    int total_tasks = (int)tasks.size();
-    if (total_tasks == 0) return false;
+// 解一整批：in 與 out 都是 BatchHeader + count 個打包盤面
+int solve_batch(const unsigned char* in, vector<unsigned char>& out) {
+    BatchHeader h;
+    memcpy(&h, in, sizeof(h));
+    int bytes = packed_bytes();
+    out.resize(sizeof(h) + (size_t)h.count * bytes);
+    memcpy(out.data(), &h, sizeof(h));
+
+    int grid[25 * 25], solution[25 * 25];
+    int solved = 0;
+    for (int k = 0; k < h.count; k++) {
+        unpack_grid(in + sizeof(h) + (size_t)k * bytes, grid);
+        if (solve_one(grid, solution)) solved++;
+        pack_grid(solution, out.data() + sizeof(h) + (size_t)k * bytes);
+    }
+    return solved;
+}
 
-    int next_task = 0;
-    int active_workers = 0;
+// worker：一直掛著一個接收，手上的批次解完就送出結果。
+// rank 0 收到一批結果才補下一批，所以手上拿到第 k 批時，第 k - BATCH_DEPTH 批的
+// 結果已經被收下；結果緩衝區只需要 BATCH_DEPTH 個輪流使用，記憶體不隨題數增加
+long long batch_worker(int batch_size) {
+    int cap = (int)sizeof(BatchHeader) + batch_size * packed_bytes();
+    vector<unsigned char> incoming(cap);
+    MPI_Request recv_req;
+    MPI_Irecv(incoming.data(), cap, MPI_BYTE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &recv_req);
+
+    deque<vector<unsigned char>> queue;
+    vector<vector<unsigned char>> results(BATCH_DEPTH);   // Isend 期間不能改寫
+    vector<MPI_Request> sends(BATCH_DEPTH, MPI_REQUEST_NULL);
+    int slot = 0;
+    bool end = false;
+    long long solved = 0;
 
-    // 初始派發：每個 worker 先拿一個 task 或直接 TERMINATE
-    for (int rank = 1; rank <= num_workers; rank++) {
-        if (next_task < total_tasks) {
-            MPI_Send(tasks[next_task].grid, SIZE * SIZE, MPI_INT, rank, TAG_TASK, MPI_COMM_WORLD);
-            next_task++;
-            active_workers++;
-        } else {
-            MPI_Send(nullptr, 0, MPI_INT, rank, TAG_TERMINATE, MPI_COMM_WORLD);
+    while (true) {
+        // 收下所有已到達的批次；手上沒事做時才阻塞等待
+        while (!end) {
+            int done = 0;
+            MPI_Status status;
+            if (queue.empty()) {
+                MPI_Wait(&recv_req, &status);
+                done = 1;
+            } else {
+                MPI_Test(&recv_req, &done, &status);
+            }
+            if (!done) break;
+            if (status.MPI_TAG == TAG_BATCH_END) {
+                end = true;
+                break;
+            }
+            int n = 0;
+            MPI_Get_count(&status, MPI_BYTE, &n);
+            queue.emplace_back(incoming.begin(), incoming.begin() + n);
+            MPI_Irecv(incoming.data(), cap, MPI_BYTE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &recv_req);
         }
+        if (queue.empty()) break;
+
+        // 重用最舊的緩衝區前先等它的送出完成
+        MPI_Wait(&sends[slot], MPI_STATUS_IGNORE);
+        solved += solve_batch(queue.front().data(), results[slot]);
+        queue.pop_front();
+        MPI_Isend(results[slot].data(), (int)results[slot].size(), MPI_BYTE, 0,
+                  TAG_BATCH_RESULT, MPI_COMM_WORLD, &sends[slot]);
+        slot = (slot + 1) % BATCH_DEPTH;
     }
 
-    int recv_grid[25 * 25];
-    MPI_Status status;
-    bool solved_flag = false;
-    int solver_rank = -1;
+    MPI_Waitall((int)sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+    return solved;
+}
 
-    while (active_workers > 0 && !solved_flag) {
-        // 等待任何 worker 的消息
-        MPI_Recv(recv_grid, SIZE * SIZE, MPI_INT, MPI_ANY_SOURCE,
-                 MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+// 把一批結果轉回字串，依題號放進 solutions (無解留空字串)
+void store_results(const unsigned char* res, int batch_size, vector<string>& solutions) {
+    BatchHeader h;
+    memcpy(&h, res, sizeof(h));
+    int grid[25 * 25];
+    for (int k = 0; k < h.count; k++) {
+        unpack_grid(res + sizeof(h) + (size_t)k * packed_bytes(), grid);
+        if (grid[0] == 0) continue;
+        string& s = solutions[h.id * batch_size + k];
+        for (int i = 0; i < SIZE * SIZE; i++) s += numToChar(grid[i]);
+    }
+}
 
-        int src = status.MPI_SOURCE;
+// rank 0：把題目切成批次並分派，結果依輸入順序放進 solutions
+void batch_master(int nprocs, const vector<string>& puzzles, int batch_size, vector<string>& solutions) {
+    int bytes = packed_bytes();
+    int total = (int)puzzles.size();
+    int num_batches = (total + batch_size - 1) / batch_size;
 
-        if (status.MPI_TAG == TAG_SOLUTION) {
-            // 有人找到解
-            memcpy(final_solution, recv_grid, SIZE * SIZE * sizeof(int));
-            solved_flag = true;
-            solver_rank = src;
-            break;
+    // 先把所有批次打包好，Isend 期間緩衝區一直有效
+    vector<vector<unsigned char>> batches(num_batches);
+    int grid[25 * 25];
+    for (int b = 0; b < num_batches; b++) {
+        BatchHeader h{b, min(batch_size, total - b * batch_size)};
+        batches[b].resize(sizeof(h) + (size_t)h.count * bytes);
+        memcpy(batches[b].data(), &h, sizeof(h));
+        for (int k = 0; k < h.count; k++) {
+            const string& p = puzzles[b * batch_size + k];
+            for (int i = 0; i < SIZE * SIZE; i++) {
+                int v = charToNum(p[i]);
+                grid[i] = (v < 0 || v > SIZE) ? 0 : v;
+            }
+            pack_grid(grid, batches[b].data() + sizeof(h) + (size_t)k * bytes);
         }
+    }
 
-        if (status.MPI_TAG == TAG_DONE) {
-            // 該 worker 完成了一個 task，看看有沒有新的 task
-            active_workers--;
+    solutions.assign(total, string());
+    int workers = nprocs - 1;
+    if (workers == 0) {
+        // 只有一個 rank：自己解
+        vector<unsigned char> out;
+        for (int b = 0; b < num_batches; b++) {
+            solve_batch(batches[b].data(), out);
+            store_results(out.data(), batch_size, solutions);
+        }
+        return;
+    }
 
-            if (next_task < total_tasks) {
-                MPI_Send(tasks[next_task].grid, SIZE * SIZE, MPI_INT,
-                         src, TAG_TASK, MPI_COMM_WORLD);
-                next_task++;
-                active_workers++;
-            } else {
-                MPI_Send(nullptr, 0, MPI_INT, src, TAG_TERMINATE, MPI_COMM_WORLD);
-            }
+    vector<MPI_Request> sends;
+    sends.reserve(num_batches + workers);
+    int next = 0;
+    vector<int> outstanding(nprocs, 0);
+    auto send_batch = [&](int w) {
+        sends.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(batches[next].data(), (int)batches[next].size(), MPI_BYTE, w,
+                  TAG_BATCH, MPI_COMM_WORLD, &sends.back());
+        next++;
+        outstanding[w]++;
+    };
+
+    for (int d = 0; d < BATCH_DEPTH; d++) {
+        for (int w = 1; w <= workers && next < num_batches; w++) send_batch(w);
+    }
+
+    // 每個 worker 掛一個結果接收 (同一個 worker 的結果依序到達)
+    int cap = (int)sizeof(BatchHeader) + batch_size * bytes;
+    vector<vector<unsigned char>> result_bufs(workers, vector<unsigned char>(cap));
+    vector<MPI_Request> recvs(workers, MPI_REQUEST_NULL);
+    for (int w = 1; w <= workers; w++) {
+        if (outstanding[w] > 0) {
+            MPI_Irecv(result_bufs[w - 1].data(), cap, MPI_BYTE, w, TAG_BATCH_RESULT,
+                      MPI_COMM_WORLD, &recvs[w - 1]);
         }
     }
 
-    // 找到解 → 通知所有 worker 結束
-    if (solved_flag) {
-        for (int rank = 1; rank <= num_workers; rank++) {
-            if (rank == solver_rank) continue;  // 已停止
-            MPI_Send(nullptr, 0, MPI_INT, rank, TAG_TERMINATE, MPI_COMM_WORLD);
+    int remaining = num_batches;
+    while (remaining > 0) {
+        int idx;
+        MPI_Waitany(workers, recvs.data(), &idx, MPI_STATUS_IGNORE);
+        int w = idx + 1;
+        outstanding[w]--;
+        remaining--;
+        // 先補下一批，再處理結果
+        if (next < num_batches) send_batch(w);
+
+        store_results(result_bufs[idx].data(), batch_size, solutions);
+
+        if (outstanding[w] > 0) {
+            MPI_Irecv(result_bufs[idx].data(), cap, MPI_BYTE, w, TAG_BATCH_RESULT,
+                      MPI_COMM_WORLD, &recvs[idx]);
         }
-        return true;
     }
 
-    // 沒有任何一個分支找到解
-    return false;
+    for (int w = 1; w <= workers; w++) {
+        sends.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(nullptr, 0, MPI_BYTE, w, TAG_BATCH_END, MPI_COMM_WORLD, &sends.back());
+    }
+    MPI_Waitall((int)sends.size(), sends.data(), MPI_STATUSES_IGNORE);
 }
 
-// --- Worker：不停接 Task，做完就回報 DONE，若有解就回 SOLUTION ---
-void worker_process() {
-    int grid_buf[25 * 25];
-    MPI_Status status;
+// 介面： mpirun -np N ./sudoku_mpi SIZE --batch [--batch-size B] [--stats] < puzzles.txt
+// stdin 每行一題 (與單題模式相同的字元格式)。rank 0 依輸入順序每題印一行：
+// 解 (同樣的字元格式) 或 "No solution found."；總結印到 stderr。
+int run_batch_mode(int rank, int nprocs, int argc, char* argv[]) {
+    int batch_size = 64;
+    bool stats = false;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) batch_size = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--stats") == 0) stats = true;
+    }
 
-    while (true) {
-        MPI_Recv(grid_buf, SIZE * SIZE, MPI_INT, 0,
-                 MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+    if (rank != 0) {
+        long long solved = batch_worker(batch_size);
+        if (stats) cerr << "rank " << rank << ": solved=" << solved << endl;
+        return 0;
+    }
 
-        if (status.MPI_TAG == TAG_TERMINATE) {
-            break;
+    vector<string> puzzles;
+    string line;
+    while (getline(cin, line)) {
+        line.erase(remove_if(line.begin(), line.end(), [](char c) { return isspace((unsigned char)c); }), line.end());
+        if (line.empty()) continue;
+        if ((int)line.size() != SIZE * SIZE) {
+            cerr << "Skipping puzzle of length " << line.size() << endl;
+            continue;
         }
+        puzzles.push_back(line);
+    }
 
-        if (status.MPI_TAG == TAG_TASK) {
-            SolverState s;
-            s.init(grid_buf);
+    vector<string> solutions;
+    auto start = chrono::high_resolution_clock::now();
+    batch_master(nprocs, puzzles, batch_size, solutions);
+    auto end = chrono::high_resolution_clock::now();
+    double wall_ms = chrono::duration<double, milli>(end - start).count();
 
-            if (solve_recursive(s)) {
-                // 找到解，送回去
-                MPI_Send(s.grid, SIZE * SIZE, MPI_INT, 0, TAG_SOLUTION, MPI_COMM_WORLD);
-                // 找到解就直接退出，master 會終止其他 worker
-                break;
-            } else {
-                int dummy = 0;
-                MPI_Send(&dummy, 1, MPI_INT, 0, TAG_DONE, MPI_COMM_WORLD);
-            }
+    long long solved = 0;
+    for (const string& s : solutions) {
+        if (s.empty()) {
+            cout << "No solution found.\n";
+        } else {
+            cout << s << '\n';
+            solved++;
         }
     }
+    cout.flush();
+    cerr << "batch: " << solved << "/" << puzzles.size() << " solved, " << wall_ms << " ms wall";
+    if (wall_ms > 0) cerr << ", " << (puzzles.size() * 1000.0 / wall_ms) << " puzzles/s";
+    cerr << endl;
+    return 0;
 }
 
 // --- Main ---
-// 介面： mpirun -np N ./sudoku_mpi SIZE PUZZLE_STRING
+// 介面： mpirun -np N ./sudoku_mpi SIZE PUZZLE_STRING [--stats]
+//       mpirun -np N ./sudoku_mpi SIZE --batch [...] < puzzles.txt (見 run_batch_mode)
+// --stats：每個 rank 在 stderr 印出展開的節點數與拿到的工作數
 // rank 0：成功 → 印 "<time> ms"，失敗 → "0.0000 ms"
 // 其他 rank：不印任何東西
 int main(int argc, char* argv[]) {
@@ -286,22 +725,23 @@ int main(int argc, char* argv[]) {
         MPI_Finalize();
         return 0;
     }
+    mrv_setup(SIZE, BLOCK_SIZE);
 
-    string puzzle = argv[2];
-    if ((int)puzzle.size() != SIZE * SIZE) {
-        if (rank == 0) cout << "0.0000 ms" << endl;
+    if (strcmp(argv[2], "--batch") == 0) {
+        run_batch_mode(rank, nprocs, argc, argv);
         MPI_Finalize();
         return 0;
     }
 
-    // worker 只需要 SIZE / BLOCK_SIZE；不需要 puzzle
-    if (rank != 0) {
-        worker_process();
+    string puzzle = argv[2];
+    if ((int)puzzle.size() != SIZE * SIZE) {
+        if (rank == 0) cout << "0.0000 ms" << endl;
         MPI_Finalize();
         return 0;
     }
 
-    // rank 0：解析 puzzle，呼叫 master
+    // 每個 rank 都解析 puzzle，在 Worker::run 裡各自展開出同一個前緣，
+    // 拿第 rank, rank+nprocs, ... 個子問題開始搜尋；做完的 rank 再去偷工作
     int* initial_grid = new int[SIZE * SIZE];
     for (int i = 0; i < SIZE * SIZE; i++) {
         int v = charToNum(puzzle[i]);
@@ -310,17 +750,23 @@ int main(int argc, char* argv[]) {
     }
 
     int final_solution[25 * 25];
+    Worker worker(rank, nprocs);
 
+    MPI_Barrier(MPI_COMM_WORLD);
     auto start = chrono::high_resolution_clock::now();
-    bool ok = master_process(nprocs - 1, initial_grid, final_solution);
+    bool ok = worker.run(initial_grid, final_solution);
     auto end = chrono::high_resolution_clock::now();
+    worker.shutdown();
 
-    if (ok) {
-        double elapsed_ms = chrono::duration<double, milli>(end - start).count();
-        cout << fixed << setprecision(4) << elapsed_ms << " ms" << endl;
-    } else {
-        cout << "0.0000 ms" << endl;
+    if (rank == 0) {
+        if (ok) {
+            double elapsed_ms = chrono::duration<double, milli>(end - start).count();
+            cout << fixed << setprecision(4) << elapsed_ms << " ms" << endl;
+        } else {
+            cout << "0.0000 ms" << endl;
+        }
     }
+    if (argc > 3 && strcmp(argv[3], "--stats") == 0) worker.print_stats();
 
     delete[] initial_grid;
 
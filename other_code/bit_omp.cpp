@@ -6,6 +6,8 @@
 #include <vector>
 #include <atomic>
 #include <iomanip>
+#include "frontier.h"
+#include "mrv_buckets.h"
 using namespace std;
 
 // OpenMP Accelerated Generic Sudoku Solver
@@ -27,6 +29,7 @@ struct SolverState {
     unsigned long long* rowMask;
     unsigned long long* colMask;
     unsigned long long* boxMask;
+    MrvBuckets buckets;
     long long backtracks;
     
     SolverState() {
@@ -62,34 +65,17 @@ struct SolverState {
                 }
             }
         }
+        mrv_init(*this);
     }
 };
 
 bool solve_recursive(SolverState& state) {
     if (solved.load(memory_order_relaxed)) return true;
     
-    int row = -1, col = -1;
-    int minCount = SIZE + 1;
-    
-    // MRV heuristic
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (state.grid[i * SIZE + j] == 0) {
-                unsigned long long used = state.rowMask[i] | state.colMask[j] | state.boxMask[getBox(i, j)];
-                unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-                
-                int count = __builtin_popcountll(available);
-                
-                if (count == 0) return false;
-                
-                if (count < minCount) {
-                    minCount = count;
-                    row = i;
-                    col = j;
-                }
-            }
-        }
-    }
+    // MRV heuristic: lowest non-empty candidate-count bucket
+    int row, col;
+    unsigned long long available = 0;
+    if (!mrv_pick(state, row, col, available)) return false;
     
     if (row == -1) {
         // Found solution!
@@ -99,11 +85,6 @@ bool solve_recursive(SolverState& state) {
         return true;
     }
     
-    unsigned long long used = state.rowMask[row] | state.colMask[col] | state.boxMask[getBox(row, col)];
-    unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-    
-    int box = getBox(row, col);
-    
     while (available) {
         if (solved.load(memory_order_relaxed)) return true;
         
@@ -112,91 +93,39 @@ bool solve_recursive(SolverState& state) {
         
         int num = __builtin_ctzll(bit);
         
-        state.grid[row * SIZE + col] = num;
-        state.rowMask[row] |= bit;
-        state.colMask[col] |= bit;
-        state.boxMask[box] |= bit;
+        mrv_set(state, row, col, num);
         
         if (solve_recursive(state)) return true;
         
-        state.grid[row * SIZE + col] = 0;
-        state.rowMask[row] ^= bit;
-        state.colMask[col] ^= bit;
-        state.boxMask[box] ^= bit;
+        mrv_clear(state, row, col);
         state.backtracks++;
     }
     
     return false;
 }
 
-// Parallel entry point
+// Parallel entry point: expand the tree breadth-first (with propagation)
+// until there are FRONTIER_PER_WORKER subproblems per thread, then run one
+// DFS per subproblem with dynamic scheduling
 void solve_parallel() {
-    // Find the first empty cell with MRV to branch on
-    // We need to find a cell with enough candidates to distribute work
-    
-    // 1. Initialize a temporary state to find branching point
-    SolverState tempState;
-    tempState.init(initial_grid);
-    
-    int row = -1, col = -1;
-    int minCount = SIZE + 1;
-    
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (tempState.grid[i * SIZE + j] == 0) {
-                unsigned long long used = tempState.rowMask[i] | tempState.colMask[j] | tempState.boxMask[getBox(i, j)];
-                unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-                int count = __builtin_popcountll(available);
-                
-                if (count == 0) return; // Impossible
-                
-                if (count < minCount) {
-                    minCount = count;
-                    row = i;
-                    col = j;
-                }
-            }
-        }
-    }
-    
-    if (row == -1) {
-        // Already solved?
+    int threads = omp_get_max_threads();
+    Frontier frontier = FrontierBuilder(SIZE, BLOCK_SIZE).build(initial_grid, FRONTIER_PER_WORKER * threads);
+
+    if (frontier.solved) {
+        // Solved while expanding
         solved = true;
-        memcpy(final_grid, initial_grid, SIZE * SIZE * sizeof(int));
+        memcpy(final_grid, frontier.solution.grid, SIZE * SIZE * sizeof(int));
         return;
     }
-    
-    // Get candidates for the branching cell
-    unsigned long long used = tempState.rowMask[row] | tempState.colMask[col] | tempState.boxMask[getBox(row, col)];
-    unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-    
-    vector<int> candidates;
-    while (available) {
-        unsigned long long bit = available & -available;
-        available ^= bit;
-        candidates.push_back(__builtin_ctzll(bit));
-    }
-    
-    // Parallelize the first level of recursion
-    #pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < candidates.size(); i++) {
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < frontier.nodes.size(); i++) {
         if (solved.load(memory_order_relaxed)) continue;
-        
-        int num = candidates[i];
-        
+
         // Create thread-local state
         SolverState localState;
-        localState.init(initial_grid);
-        
-        // Apply the move
-        unsigned long long bit = 1ULL << num;
-        int box = getBox(row, col);
-        
-        localState.grid[row * SIZE + col] = num;
-        localState.rowMask[row] |= bit;
-        localState.colMask[col] |= bit;
-        localState.boxMask[box] |= bit;
-        
+        localState.init(frontier.nodes[i].grid);
+
         // Continue search
         solve_recursive(localState);
     }
@@ -227,8 +156,45 @@ void printGrid(int* g) {
     }
 }
 
+// Usage: ./sudoku_omp SIZE PUZZLE_STRING
+// Prints "<time> ms" on success, "0.0000 ms" on failure or bad input
 int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <size> <puzzle>\n";
+        cout << "0.0000 ms" << endl;
+        return 0;
+    }
+
+    SIZE = atoi(argv[1]);
+    string puzzle = argv[2];
+
+    if (SIZE == 4) BLOCK_SIZE = 2;
+    else if (SIZE == 9) BLOCK_SIZE = 3;
+    else if (SIZE == 16) BLOCK_SIZE = 4;
+    else if (SIZE == 25) BLOCK_SIZE = 5;
+    else {
+        cerr << "Unsupported size: " << SIZE << endl;
+        cout << "0.0000 ms" << endl;
+        return 0;
+    }
 
+    mrv_setup(SIZE, BLOCK_SIZE);
+
+    if ((int)puzzle.length() != SIZE * SIZE) {
+        cerr << "Error: Puzzle length (" << puzzle.length()
+             << ") does not match size^2 (" << SIZE * SIZE << ").\n";
+        cout << "0.0000 ms" << endl;
+        return 0;
+    }
+
+    initial_grid = new int[SIZE * SIZE];
+    final_grid = new int[SIZE * SIZE];
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        int v = charToNum(puzzle[i]);
+        if (v < 0 || v > SIZE) v = 0;
+        initial_grid[i] = v;
+        final_grid[i] = 0;
+    }
 
     auto start = chrono::high_resolution_clock::now();
 
@@ -238,13 +204,12 @@ int main(int argc, char* argv[]) {
     double elapsed_ms = chrono::duration<double, milli>(end - start).count();
 
     if (solved) {
-        cout << fixed << setprecision(4) << elapsed_ms << " ms" << endl; 
+        cout << fixed << setprecision(4) << elapsed_ms << " ms" << endl;
+        // printGrid(final_grid);
     } else {
         cout << "0.0000 ms" << endl;
     }
 
-    // -------------------------------------------------------------------
-    
     delete[] initial_grid;
     delete[] final_grid;
 
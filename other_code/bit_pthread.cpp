@@ -7,8 +7,14 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <algorithm>
 #include <iomanip>
+#include <cctype>
+#include "../src/sudoku_affinity.h"
+#include "frontier.h"
+#include "mrv_buckets.h"
 
 using namespace std;
 
@@ -17,8 +23,7 @@ int SIZE;
 int BLOCK_SIZE;
 int* initial_grid = nullptr;
 int* final_grid = nullptr;
-atomic<bool> solved(false);
-mutex final_grid_mutex; // 用於保護寫入 final_grid
+atomic<bool> solved(false);   // 第一個把它從 false 換成 true 的執行緒寫入 final_grid
 
 // --- 輔助函數 (Utility Functions) ---
 
@@ -59,6 +64,7 @@ struct SolverState {
     unsigned long long rowMask[25];
     unsigned long long colMask[25];
     unsigned long long boxMask[25];
+    MrvBuckets buckets;   // 依候選數分桶的空格，取代每個節點的全盤掃描
 
     void init(const int* input_grid) {
         memcpy(grid, input_grid, SIZE * SIZE * sizeof(int));
@@ -77,154 +83,187 @@ struct SolverState {
                 }
             }
         }
+        mrv_init(*this);
     }
 };
 
+class SolverPool;
+
 // --- 核心回溯函數 (Core Backtracking Function) ---
-bool solve_recursive(SolverState& state) {
-    // 搶先式終止檢查
-    if (solved.load(memory_order_relaxed)) return true;
+bool solve_recursive(SolverState& state, SolverPool& pool);
+
+// --- 固定大小的執行緒池 (Fixed Thread Pool) ---
+// 執行緒在建構時建立一次，之後每次 solve 都重複使用。所有子問題放在一個共用的
+// deque：有執行緒閒著 (等待的執行緒比佇列中的子問題多) 時，正在搜尋的執行緒
+// 把目前節點其餘的候選數各自切成一個子問題放回 deque，自己繼續往下搜尋。
+// 因此平行度不受第一個格子的候選數限制。
+class SolverPool {
+public:
+    SolverPool(int threads, PinPolicy policy) : policy(policy), placement(threads, -1) {
+        if (policy != PIN_NONE) order = placement_order(policy);
+        for (int i = 0; i < threads; i++) workers.emplace_back(&SolverPool::worker_loop, this, i);
+    }
 
-    int row = -1, col = -1;
-    int minCount = SIZE + 1;
+    ~SolverPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stop = true;
+        }
+        work_cv.notify_all();
+        for (auto& t : workers) t.join();
+    }
 
-    // 1. MRV 啟發式尋找最佳空單元格
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (state.grid[i * SIZE + j] == 0) {
-                unsigned long long used = state.rowMask[i] |
-                                          state.colMask[j] |
-                                          state.boxMask[getBox(i, j)];
-                // bits 1..SIZE 有效 (bit 0 保留不用)
-                unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
+    // 解一題，解寫入 final_grid；回傳是否有解。先以廣度優先展開出每條執行緒
+    // FRONTIER_PER_WORKER 個子問題放進 deque，之後再視需要切割。
+    bool solve(const int* grid) {
+        solved.store(false);
+        Frontier frontier = FrontierBuilder(SIZE, BLOCK_SIZE).build(grid, FRONTIER_PER_WORKER * (int)workers.size());
+        if (frontier.solved) {
+            solved.store(true);
+            memcpy(final_grid, frontier.solution.grid, SIZE * SIZE * sizeof(int));
+            return true;
+        }
+        if (frontier.nodes.empty()) return false;
+
+        {
+            lock_guard<mutex> guard(lock);
+            pending = (int)frontier.nodes.size();
+            // 淺層的子問題放在後面，先被取走
+            for (int i = (int)frontier.nodes.size() - 1; i >= 0; i--) {
+                tasks.emplace_back();
+                tasks.back().init(frontier.nodes[i].grid);
+            }
+            queued = (int)tasks.size();
+        }
+        work_cv.notify_all();
 
-                int count = __builtin_popcountll(available);
+        unique_lock<mutex> guard(lock);
+        done_cv.wait(guard, [this] { return pending == 0; });
+        return solved.load();
+    }
 
-                if (count == 0) return false;
+    // 有執行緒在等工作、而佇列裡的子問題不夠分
+    bool hungry() const {
+        return waiting.load(memory_order_relaxed) > queued.load(memory_order_relaxed);
+    }
 
-                if (count < minCount) {
-                    minCount = count;
-                    row = i;
-                    col = j;
-                }
+    // 把 (row, col) 還沒試的候選數 available 各自切成一個子問題
+    void split(const SolverState& state, int row, int col, unsigned long long available) {
+        int count = 0;
+        {
+            lock_guard<mutex> guard(lock);
+            while (available) {
+                unsigned long long bit = available & -available;
+                available ^= bit;
+                tasks.push_back(state);
+                mrv_set(tasks.back(), row, col, __builtin_ctzll(bit));
+                count++;
             }
+            pending += count;
+            queued += count;
         }
+        if (count == 1) work_cv.notify_one();
+        else work_cv.notify_all();
     }
 
-    if (row == -1) {
-        // 找到解決方案
-        if (!solved.exchange(true)) {
-            lock_guard<mutex> lock(final_grid_mutex);
-            memcpy(final_grid, state.grid, SIZE * SIZE * sizeof(int));
-        }
-        return true;
+    void report_placement(ostream& out) {
+        lock_guard<mutex> guard(lock);
+        ::report_placement(out, policy, placement);
     }
 
-    // 2. 嘗試所有候選值
-    unsigned long long used = state.rowMask[row] |
-                              state.colMask[col] |
-                              state.boxMask[getBox(row, col)];
-    unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-    int box = getBox(row, col);
+private:
+    PinPolicy policy;
+    vector<CpuInfo> order;
+    vector<int> placement;      // 每條執行緒實際所在的 CPU
+    vector<thread> workers;
+
+    mutex lock;
+    condition_variable work_cv; // 有新的子問題或要結束
+    condition_variable done_cv; // pending 歸零
+    deque<SolverState> tasks;
+    int pending = 0;            // 佇列中 + 執行中的子問題
+    bool stop = false;
+    atomic<int> queued{0};      // tasks.size()，給 hungry() 不加鎖讀
+    atomic<int> waiting{0};     // 正在等工作的執行緒數
+
+    void worker_loop(int index) {
+        // 先綁定 CPU，之後複製到堆疊上的 SolverState 都由本執行緒 first-touch
+        if (policy != PIN_NONE) pin_worker(order, index);
+        {
+            lock_guard<mutex> guard(lock);
+            placement[index] = sched_getcpu();
+        }
 
-    while (available) {
-        if (solved.load(memory_order_relaxed)) return true;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            waiting++;
+            work_cv.wait(guard, [this] { return stop || !tasks.empty(); });
+            waiting--;
+            if (stop) return;
 
-        unsigned long long bit = available & -available;
-        available ^= bit;
-        int num = __builtin_ctzll(bit);
-
-        // 嘗試填入 num
-        state.grid[row * SIZE + col] = num;
-        state.rowMask[row] |= bit;
-        state.colMask[col] |= bit;
-        state.boxMask[box] |= bit;
+            // 取最新的子問題 (深度優先，較可能接近解)
+            SolverState state = tasks.back();
+            tasks.pop_back();
+            queued--;
+            guard.unlock();
 
-        if (solve_recursive(state)) return true;
+            if (!solved.load(memory_order_relaxed)) solve_recursive(state, *this);
 
-        // 回溯
-        state.grid[row * SIZE + col] = 0;
-        state.rowMask[row] ^= bit;
-        state.colMask[col] ^= bit;
-        state.boxMask[box] ^= bit;
+            guard.lock();
+            if (--pending == 0) done_cv.notify_all();
+        }
     }
+};
 
-    return false;
-}
-
-// --- 執行緒入口點 (Thread Entry Point) ---
-void thread_entry(SolverState localState) {
-    solve_recursive(localState);
-}
-
-// --- 平行入口點 (Parallel Entry Point) ---
-void solve_parallel_pthreads() {
-    SolverState tempState;
-    tempState.init(initial_grid);
-
-    int row = -1, col = -1;
-    int minCount = SIZE + 1;
+// --- 核心回溯函數 (Core Backtracking Function) ---
+bool solve_recursive(SolverState& state, SolverPool& pool) {
+    // 搶先式終止檢查
+    if (solved.load(memory_order_relaxed)) return true;
 
-    // 使用 MRV 找到分支點
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (tempState.grid[i * SIZE + j] == 0) {
-                unsigned long long used = tempState.rowMask[i] |
-                                          tempState.colMask[j] |
-                                          tempState.boxMask[getBox(i, j)];
-                unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-                int count = __builtin_popcountll(available);
-
-                if (count == 0) return; // 無解
-
-                if (count < minCount) {
-                    minCount = count;
-                    row = i;
-                    col = j;
-                }
-            }
-        }
-    }
+    // 1. MRV：候選數最少的非空桶，O(1)；有空格無候選數時回傳 false
+    int row, col;
+    unsigned long long available = 0;
+    if (!mrv_pick(state, row, col, available)) return false;
 
     if (row == -1) {
-        // 已經是完整解
-        solved.store(true);
-        memcpy(final_grid, initial_grid, SIZE * SIZE * sizeof(int));
-        return;
+        // 找到解決方案：exchange 保證只有一個執行緒寫 final_grid，
+        // solve() 經由 pool 的鎖等到 pending 歸零後才讀
+        if (!solved.exchange(true, memory_order_acq_rel)) {
+            memcpy(final_grid, state.grid, SIZE * SIZE * sizeof(int));
+        }
+        return true;
     }
 
-    // 取得分支點候選
-    unsigned long long used = tempState.rowMask[row] |
-                              tempState.colMask[col] |
-                              tempState.boxMask[getBox(row, col)];
-    unsigned long long available = ((1ULL << (SIZE + 1)) - 2) & ~used;
-
-    vector<thread> threads;
-    int box = getBox(row, col);
-
+    // 2. 嘗試所有候選值
     while (available) {
+        if (solved.load(memory_order_relaxed)) return true;
+
         unsigned long long bit = available & -available;
         available ^= bit;
         int num = __builtin_ctzll(bit);
 
-        // 以 tempState 為基礎複製一份 localState
-        SolverState localState = tempState;
+        // 有執行緒閒著：其餘候選數交給 pool，自己只試 num
+        if (available && pool.hungry()) {
+            pool.split(state, row, col, available);
+            available = 0;
+        }
 
-        localState.grid[row * SIZE + col] = num;
-        localState.rowMask[row] |= bit;
-        localState.colMask[col] |= bit;
-        localState.boxMask[box] |= bit;
+        // 嘗試填入 num
+        mrv_set(state, row, col, num);
 
-        threads.emplace_back(thread_entry, localState);
-    }
+        if (solve_recursive(state, pool)) return true;
 
-    for (auto& t : threads) {
-        if (t.joinable()) t.join();
+        // 回溯
+        mrv_clear(state, row, col);
     }
+
+    return false;
 }
 
 // --- Main 函數 ---
-// 介面： ./sudoku_pthread SIZE PUZZLE_STRING
+// 介面： ./sudoku_pthread SIZE PUZZLE_STRING [THREADS] [compact|scatter|cores]
+//       THREADS 為執行緒池大小 (預設為硬體執行緒數)；
+//       綁定策略的實際配置印到 stderr
 // 成功： <time> ms
 // 失敗或輸入錯誤： 0.0000 ms
 int main(int argc, char* argv[]) {
@@ -233,7 +272,7 @@ int main(int argc, char* argv[]) {
 
     if (argc < 3) {
         // benchmark 用：不要丟非 0 code，印出 0.0000 ms 即可
-        cerr << "Usage: " << argv[0] << " <size> <puzzle>\n";
+        cerr << "Usage: " << argv[0] << " <size> <puzzle> [threads] [compact|scatter|cores]\n";
         cout << "0.0000 ms" << endl;
         return 0;
     }
@@ -241,6 +280,13 @@ int main(int argc, char* argv[]) {
     SIZE = atoi(argv[1]);
     string puzzle = argv[2];
 
+    int threads = max(1u, thread::hardware_concurrency());
+    PinPolicy pin_policy = PIN_NONE;
+    for (int i = 3; i < argc; i++) {
+        if (isdigit((unsigned char)argv[i][0])) threads = max(1, atoi(argv[i]));
+        else if (!parse_pin_policy(argv[i], pin_policy)) cerr << "Unknown pin policy " << argv[i] << ", not pinning." << endl;
+    }
+
     if (SIZE == 4) BLOCK_SIZE = 2;
     else if (SIZE == 9) BLOCK_SIZE = 3;
     else if (SIZE == 16) BLOCK_SIZE = 4;
@@ -250,6 +296,7 @@ int main(int argc, char* argv[]) {
         cout << "0.0000 ms" << endl;
         return 0;
     }
+    mrv_setup(SIZE, BLOCK_SIZE);
 
     if ((int)puzzle.length() != SIZE * SIZE) {
         cerr << "Error: Puzzle length (" << puzzle.length()
@@ -268,16 +315,19 @@ int main(int argc, char* argv[]) {
         final_grid[i] = 0;
     }
 
-    solved.store(false);
+    // 執行緒池在計時前建立，計時只包含解題
+    SolverPool pool(threads, pin_policy);
 
     auto start = chrono::high_resolution_clock::now();
 
-    solve_parallel_pthreads();
+    bool ok = pool.solve(initial_grid);
 
     auto end = chrono::high_resolution_clock::now();
     double elapsed_ms = chrono::duration<double, milli>(end - start).count();
 
-    if (solved.load()) {
+    if (pin_policy != PIN_NONE) pool.report_placement(cerr);
+
+    if (ok) {
         cout << fixed << setprecision(4) << elapsed_ms << " ms" << endl;
         // 如要 debug，你可以暫時打開：
         // printGrid(final_grid);
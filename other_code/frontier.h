@@ -0,0 +1,195 @@
+#ifndef FRONTIER_H
+#define FRONTIER_H
+
+// --- 廣度優先前緣 (Breadth-First Frontier) ---
+// 平行搜尋前先把搜尋樹以廣度優先展開，直到有 target 個尚未解完的子問題
+// (通常是 FRONTIER_PER_WORKER × worker 數)，再把這些子問題分給 worker 做 DFS。
+// 這樣負載平衡不再取決於單一格子的候選數 (2–9 個)。
+//
+// 每個節點都做約束傳播 (naked single + hidden single)，矛盾的分支在展開時就
+// 被丟掉；若展開途中就解完，solved 為 true、solution 即為解。
+// OpenMP、pthread、MPI 三個版本共用，只依賴標準函式庫。
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#define FRONTIER_PER_WORKER 4   // 每個 worker 分到的子問題數
+
+struct FrontierNode {
+    int grid[25 * 25];
+    unsigned long long rowMask[25];
+    unsigned long long colMask[25];
+    unsigned long long boxMask[25];
+};
+
+struct Frontier {
+    std::vector<FrontierNode> nodes;   // 尚未解完的子問題，淺層在前
+    bool solved = false;
+    FrontierNode solution;
+};
+
+class FrontierBuilder {
+public:
+    FrontierBuilder(int size, int block_size)
+        : size(size), block(block_size), full(((1ULL << (size + 1)) - 2)) {}
+
+    Frontier build(const int* grid, int target) {
+        Frontier f;
+        FrontierNode root;
+        memset(&root, 0, sizeof(root));
+        for (int i = 0; i < size * size; i++) {
+            if (grid[i] != 0) {
+                int r = i / size, c = i % size;
+                unsigned long long bit = 1ULL << grid[i];
+                // 題目本身有重複的數字 → 無解
+                if ((root.rowMask[r] | root.colMask[c] | root.boxMask[box_of(r, c)]) & bit) return f;
+                place(root, r, c, grid[i]);
+            }
+        }
+        if (!propagate(root)) return f;
+
+        std::deque<FrontierNode> open;
+        open.push_back(root);
+        while (!open.empty() && (int)open.size() < target) {
+            FrontierNode node = open.front();
+            open.pop_front();
+
+            int row = -1, col = -1;
+            unsigned long long candidates = 0;
+            pick(node, row, col, candidates);
+            if (row == -1) {
+                f.solved = true;
+                f.solution = node;
+                return f;
+            }
+
+            while (candidates) {
+                unsigned long long bit = candidates & -candidates;
+                candidates ^= bit;
+                FrontierNode child = node;
+                place(child, row, col, __builtin_ctzll(bit));
+                if (propagate(child)) open.push_back(child);
+            }
+        }
+
+        // 展開到一半可能已經有填滿的節點 (傳播後沒有空格)
+        for (const FrontierNode& n : open) {
+            int row = -1, col = -1;
+            unsigned long long candidates = 0;
+            pick(n, row, col, candidates);
+            if (row == -1) {
+                f.solved = true;
+                f.solution = n;
+                f.nodes.clear();
+                return f;
+            }
+            f.nodes.push_back(n);
+        }
+        return f;
+    }
+
+private:
+    int size, block;
+    unsigned long long full;   // bits 1..size
+
+    int box_of(int r, int c) const {
+        return (r / block) * block + (c / block);
+    }
+
+    unsigned long long available(const FrontierNode& n, int r, int c) const {
+        return full & ~(n.rowMask[r] | n.colMask[c] | n.boxMask[box_of(r, c)]);
+    }
+
+    void place(FrontierNode& n, int r, int c, int num) const {
+        unsigned long long bit = 1ULL << num;
+        n.grid[r * size + c] = num;
+        n.rowMask[r] |= bit;
+        n.colMask[c] |= bit;
+        n.boxMask[box_of(r, c)] |= bit;
+    }
+
+    // 第 unit 個單位 (0..size-1 列、size..2size-1 行、之後是宮) 的第 k 格
+    void unit_cell(int unit, int k, int& r, int& c) const {
+        if (unit < size) {
+            r = unit;
+            c = k;
+        } else if (unit < 2 * size) {
+            r = k;
+            c = unit - size;
+        } else {
+            int b = unit - 2 * size;
+            r = (b / block) * block + k / block;
+            c = (b % block) * block + k % block;
+        }
+    }
+
+    // 反覆套用 naked single 與 hidden single 直到沒有進展；矛盾回傳 false
+    bool propagate(FrontierNode& n) const {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+
+            for (int r = 0; r < size; r++) {
+                for (int c = 0; c < size; c++) {
+                    if (n.grid[r * size + c] != 0) continue;
+                    unsigned long long avail = available(n, r, c);
+                    if (avail == 0) return false;
+                    if ((avail & (avail - 1)) == 0) {
+                        place(n, r, c, __builtin_ctzll(avail));
+                        changed = true;
+                    }
+                }
+            }
+
+            for (int unit = 0; unit < 3 * size; unit++) {
+                for (int num = 1; num <= size; num++) {
+                    unsigned long long bit = 1ULL << num;
+                    int count = 0, last_r = -1, last_c = -1;
+                    bool placed = false;
+                    for (int k = 0; k < size && count < 2; k++) {
+                        int r, c;
+                        unit_cell(unit, k, r, c);
+                        if (n.grid[r * size + c] == num) {
+                            placed = true;
+                            break;
+                        }
+                        if (n.grid[r * size + c] == 0 && (available(n, r, c) & bit)) {
+                            count++;
+                            last_r = r;
+                            last_c = c;
+                        }
+                    }
+                    if (placed) continue;
+                    if (count == 0) return false;   // 這個數字在這個單位放不下
+                    if (count == 1) {
+                        place(n, last_r, last_c, num);
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // MRV：候選數最少的空格；沒有空格時 row == -1
+    void pick(const FrontierNode& n, int& row, int& col, unsigned long long& candidates) const {
+        int best = size + 1;
+        row = -1;
+        for (int r = 0; r < size; r++) {
+            for (int c = 0; c < size; c++) {
+                if (n.grid[r * size + c] != 0) continue;
+                unsigned long long avail = available(n, r, c);
+                int count = __builtin_popcountll(avail);
+                if (count < best) {
+                    best = count;
+                    row = r;
+                    col = c;
+                    candidates = avail;
+                }
+            }
+        }
+    }
+};
+
+#endif
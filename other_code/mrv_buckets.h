@@ -0,0 +1,153 @@
+#ifndef MRV_BUCKETS_H
+#define MRV_BUCKETS_H
+
+// --- MRV 候選數桶 (Candidate-Count Buckets) ---
+// 原本每個搜尋節點都掃過全部 SIZE² 格找候選數最少的空格 (25×25 是 625 格)。
+// 這裡讓每個空格保存自己的候選數 mask，並依候選數掛在 head[k] 的雙向串列上，
+// nonempty 的第 k 個 bit 表示第 k 個桶有格子：
+//   - 填入數字只會影響同列、同行、同宮的 peer (25×25 最多 64 格)，
+//     失去這個數字的 peer 移到下一個桶；
+//   - 清除數字時做完全相反的更新 (用 mask 判斷哪些 peer 重新可以填)，
+//     桶就回到填入前的狀態；
+//   - MRV = nonempty 最低的 bit，有空格無候選數 = bit 0，都是 O(1)。
+// State 需要有 grid / rowMask / colMask / boxMask (同各版本的 SolverState) 與
+// MrvBuckets buckets 成員。平手時取最後放進桶的格子，展開順序與逐格掃描不同。
+// OpenMP、pthread、MPI 三個版本共用，只依賴標準函式庫。
+
+#define MRV_MAX_PEERS 64   // 25×25：24 + 24 + 16
+
+struct MrvBuckets {
+    unsigned long long cand[25 * 25];   // 空格的候選數 (bits 1..SIZE)，已填為 0
+    unsigned char count[25 * 25];       // 空格所在的桶
+    short next[25 * 25];
+    short prev[25 * 25];
+    short head[26];                     // -1 表示空桶
+    unsigned long long nonempty;
+};
+
+// 盤面幾何：每格的 peer，由 mrv_setup 依 SIZE 建一次
+static int mrv_size, mrv_block, mrv_peer_count;
+static short mrv_peers[25 * 25][MRV_MAX_PEERS];
+
+inline void mrv_setup(int size, int block) {
+    mrv_size = size;
+    mrv_block = block;
+    for (int cell = 0; cell < size * size; cell++) {
+        int r = cell / size, c = cell % size, k = 0;
+        for (int j = 0; j < size; j++) {
+            if (j != c) mrv_peers[cell][k++] = (short)(r * size + j);
+        }
+        for (int i = 0; i < size; i++) {
+            if (i != r) mrv_peers[cell][k++] = (short)(i * size + c);
+        }
+        int br = r - r % block, bc = c - c % block;
+        for (int i = br; i < br + block; i++) {
+            for (int j = bc; j < bc + block; j++) {
+                if (i != r && j != c) mrv_peers[cell][k++] = (short)(i * size + j);
+            }
+        }
+        mrv_peer_count = k;
+    }
+}
+
+template <class State>
+inline unsigned long long mrv_available(const State& s, int cell) {
+    int r = cell / mrv_size, c = cell % mrv_size;
+    unsigned long long used = s.rowMask[r] | s.colMask[c] |
+                              s.boxMask[(r / mrv_block) * mrv_block + c / mrv_block];
+    return ((1ULL << (mrv_size + 1)) - 2) & ~used;
+}
+
+inline void mrv_link(MrvBuckets& b, int cell, int k) {
+    b.count[cell] = (unsigned char)k;
+    b.prev[cell] = -1;
+    b.next[cell] = b.head[k];
+    if (b.head[k] >= 0) b.prev[b.head[k]] = (short)cell;
+    b.head[k] = (short)cell;
+    b.nonempty |= 1ULL << k;
+}
+
+inline void mrv_unlink(MrvBuckets& b, int cell) {
+    int k = b.count[cell];
+    if (b.prev[cell] >= 0) b.next[b.prev[cell]] = b.next[cell];
+    else b.head[k] = b.next[cell];
+    if (b.next[cell] >= 0) b.prev[b.next[cell]] = b.prev[cell];
+    if (b.head[k] < 0) b.nonempty &= ~(1ULL << k);
+}
+
+// 盤面與 mask 設定好之後呼叫，把每個空格放進它的桶
+template <class State>
+inline void mrv_init(State& s) {
+    MrvBuckets& b = s.buckets;
+    b.nonempty = 0;
+    for (int k = 0; k <= mrv_size; k++) b.head[k] = -1;
+    for (int cell = 0; cell < mrv_size * mrv_size; cell++) {
+        if (s.grid[cell] != 0) {
+            b.cand[cell] = 0;
+            continue;
+        }
+        b.cand[cell] = mrv_available(s, cell);
+        mrv_link(b, cell, __builtin_popcountll(b.cand[cell]));
+    }
+}
+
+// 在空格 (row, col) 填入 num，同時更新 mask 與 peer 的桶
+template <class State>
+inline void mrv_set(State& s, int row, int col, int num) {
+    MrvBuckets& b = s.buckets;
+    unsigned long long bit = 1ULL << num;
+    int cell = row * mrv_size + col;
+    mrv_unlink(b, cell);
+    b.cand[cell] = 0;
+    for (int k = 0; k < mrv_peer_count; k++) {
+        int p = mrv_peers[cell][k];
+        if (b.cand[p] & bit) {
+            b.cand[p] ^= bit;
+            mrv_unlink(b, p);
+            mrv_link(b, p, b.count[p] - 1);
+        }
+    }
+    s.grid[cell] = num;
+    s.rowMask[row] |= bit;
+    s.colMask[col] |= bit;
+    s.boxMask[(row / mrv_block) * mrv_block + col / mrv_block] |= bit;
+}
+
+// 清除 (row, col)：mrv_set 的反向操作。peer 只有在清除後 mask 允許時才拿回這個數字
+template <class State>
+inline void mrv_clear(State& s, int row, int col) {
+    MrvBuckets& b = s.buckets;
+    int cell = row * mrv_size + col;
+    unsigned long long bit = 1ULL << s.grid[cell];
+    s.grid[cell] = 0;
+    s.rowMask[row] ^= bit;
+    s.colMask[col] ^= bit;
+    s.boxMask[(row / mrv_block) * mrv_block + col / mrv_block] ^= bit;
+    for (int k = 0; k < mrv_peer_count; k++) {
+        int p = mrv_peers[cell][k];
+        if (s.grid[p] == 0 && (mrv_available(s, p) & bit)) {
+            b.cand[p] |= bit;
+            mrv_unlink(b, p);
+            mrv_link(b, p, b.count[p] + 1);
+        }
+    }
+    b.cand[cell] = mrv_available(s, cell);
+    mrv_link(b, cell, __builtin_popcountll(b.cand[cell]));
+}
+
+// MRV：回傳 false 表示有空格無候選數 (矛盾)；row == -1 表示盤面已填滿
+template <class State>
+inline bool mrv_pick(const State& s, int& row, int& col, unsigned long long& candidates) {
+    const MrvBuckets& b = s.buckets;
+    row = -1;
+    col = -1;
+    if (b.nonempty == 0) return true;
+    if (b.nonempty & 1) return false;
+    int cell = b.head[__builtin_ctzll(b.nonempty)];
+    row = cell / mrv_size;
+    col = cell % mrv_size;
+    candidates = b.cand[cell];
+    return true;
+}
+
+#endif
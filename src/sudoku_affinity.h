@@ -0,0 +1,194 @@
+#ifndef SUDOKU_AFFINITY_H
+#define SUDOKU_AFFINITY_H
+
+#include <sched.h>
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// --- Thread placement (--pin compact|scatter|cores) ---
+// Left alone, the OS moves threads between cores and sockets, which is what
+// makes scaling runs on multi-socket hosts hard to reproduce. Each policy
+// maps worker i to one CPU out of the process's allowed set:
+//   compact  fill a core's hardware threads, then the next core, node by node
+//   scatter  round-robin over NUMA nodes, physical cores before SMT siblings
+//   cores    one hardware thread per physical core, compact order
+// More workers than CPUs wrap around. Threads pin themselves, so state they
+// allocate afterwards is first-touched on their own node.
+//
+// Only needs the C++ standard library and Linux, so the solvers in
+// other_code/ use it as well.
+
+enum PinPolicy { PIN_NONE, PIN_COMPACT, PIN_SCATTER, PIN_CORES, PIN_COUNT };
+static const char* const pin_policy_names[PIN_COUNT] = {"none", "compact", "scatter", "cores"};
+
+inline bool parse_pin_policy(const char* name, PinPolicy& policy) {
+    for (int i = 0; i < PIN_COUNT; i++) {
+        if (strcmp(name, pin_policy_names[i]) == 0) {
+            policy = (PinPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct CpuInfo {
+    int cpu;
+    int node;
+    int package;
+    int core;
+};
+
+inline int read_sys_int(const std::string& path, int fallback) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return fallback;
+    int value = fallback;
+    if (fscanf(f, "%d", &value) != 1) value = fallback;
+    fclose(f);
+    return value;
+}
+
+// NUMA node of a CPU: the nodeK entry in its sysfs directory, 0 if none
+inline int cpu_node(int cpu) {
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* d = opendir(dir.c_str());
+    if (!d) return 0;
+    int node = 0;
+    while (dirent* e = readdir(d)) {
+        if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(d);
+    return node;
+}
+
+// The CPUs this process may run on, sorted node, package, core, CPU, so
+// SMT siblings are adjacent
+inline std::vector<CpuInfo> cpu_topology() {
+    std::vector<CpuInfo> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        std::string topo = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        CpuInfo info;
+        info.cpu = cpu;
+        info.node = cpu_node(cpu);
+        info.package = read_sys_int(topo + "physical_package_id", 0);
+        info.core = read_sys_int(topo + "core_id", cpu);
+        cpus.push_back(info);
+    }
+    std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        if (a.node != b.node) return a.node < b.node;
+        if (a.package != b.package) return a.package < b.package;
+        if (a.core != b.core) return a.core < b.core;
+        return a.cpu < b.cpu;
+    });
+    return cpus;
+}
+
+inline bool same_core(const CpuInfo& a, const CpuInfo& b) {
+    return a.package == b.package && a.core == b.core;
+}
+
+// CPU order of a policy; worker i runs on order[i % order.size()]
+inline std::vector<CpuInfo> placement_order(PinPolicy policy) {
+    std::vector<CpuInfo> cpus = cpu_topology();
+    if (policy == PIN_COMPACT || cpus.empty()) return cpus;
+
+    // SMT rank: 0 for the first hardware thread of a core, 1 for the next...
+    std::vector<int> rank(cpus.size(), 0);
+    for (size_t i = 1; i < cpus.size(); i++) {
+        if (same_core(cpus[i], cpus[i - 1])) rank[i] = rank[i - 1] + 1;
+    }
+
+    std::vector<CpuInfo> order;
+    if (policy == PIN_CORES) {
+        for (size_t i = 0; i < cpus.size(); i++) {
+            if (rank[i] == 0) order.push_back(cpus[i]);
+        }
+        return order;
+    }
+
+    // Scatter: per node, cores first and siblings after; then deal the
+    // nodes' lists out one CPU at a time
+    std::vector<std::vector<CpuInfo>> per_node;
+    int max_rank = *std::max_element(rank.begin(), rank.end());
+    for (int r = 0; r <= max_rank; r++) {
+        for (size_t i = 0; i < cpus.size(); i++) {
+            if (rank[i] != r) continue;
+            size_t n = 0;
+            while (n < per_node.size() && per_node[n][0].node != cpus[i].node) n++;
+            if (n == per_node.size()) per_node.push_back(std::vector<CpuInfo>());
+            per_node[n].push_back(cpus[i]);
+        }
+    }
+    for (size_t k = 0; order.size() < cpus.size(); k++) {
+        for (size_t n = 0; n < per_node.size(); n++) {
+            if (k < per_node[n].size()) order.push_back(per_node[n][k]);
+        }
+    }
+    return order;
+}
+
+inline bool pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// Pin the calling thread as worker `index` of the policy. Returns the CPU,
+// or -1 when nothing was pinned.
+inline int pin_worker(const std::vector<CpuInfo>& order, int index) {
+    if (order.empty()) return -1;
+    int cpu = order[index % order.size()].cpu;
+    return pin_current_thread(cpu) ? cpu : -1;
+}
+
+// "placement (compact, 4 threads): 0->cpu0/n0/c0 1->cpu1/n0/c0 ..." from
+// the CPU each worker reported with sched_getcpu() after pinning
+inline void report_placement(std::ostream& out, PinPolicy policy, const std::vector<int>& cpus) {
+    std::vector<CpuInfo> all = cpu_topology();
+    out << "placement (" << pin_policy_names[policy] << ", " << cpus.size() << " threads):";
+    for (size_t t = 0; t < cpus.size(); t++) {
+        out << " " << t << "->cpu" << cpus[t];
+        for (const CpuInfo& c : all) {
+            if (c.cpu == cpus[t]) out << "/n" << c.node << "/c" << c.core;
+        }
+    }
+    out << std::endl;
+}
+
+#ifdef _OPENMP
+#include <omp.h>
+
+// Pin every thread of the OpenMP team, let each one touch its per-thread
+// state while pinned (warm), and report where the team ended up. libgomp
+// keeps the same threads for later regions of the same size, so the
+// placement holds for the rest of the run.
+template <class Warm>
+inline void pin_omp_team(PinPolicy policy, Warm warm, std::ostream& report) {
+    std::vector<CpuInfo> order;
+    if (policy != PIN_NONE) order = placement_order(policy);
+    std::vector<int> effective(omp_get_max_threads(), -1);
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        if (policy != PIN_NONE) pin_worker(order, t);
+        warm();
+        effective[t] = sched_getcpu();
+    }
+    report_placement(report, policy, effective);
+}
+#endif
+
+#endif
@@ -0,0 +1,126 @@
+#include <sstream>
+#include <string>
+#include "sudoku_simd.h"
+#include "sudoku_dlx.h"
+#include "sudoku_batch.h"
+
+// Mixed-size solver: one binary with the solvers instantiated for 4x4, 9x9,
+// 16x16, 25x25 and 36x36. Each puzzle's size is read from its first line (the
+// number of values on it), so puzzles of different sizes can be streamed
+// through the same process. Every instantiation keeps constant geometry.
+
+enum Engine { ENGINE_SERIAL, ENGINE_SIMD, ENGINE_DLX };
+
+// Read the next puzzle. The first non-empty line fixes N; the remaining
+// N * N - N values may be laid out freely. Returns false at end of input.
+bool read_any_grid(istream& in, int& n, vector<int>& values) {
+    string line;
+    while (getline(in, line)) {
+        istringstream first(line);
+        values.clear();
+        int v;
+        while (first >> v) values.push_back(v);
+        if (values.empty()) continue;
+
+        n = (int)values.size();
+        while ((int)values.size() < n * n && in >> v) values.push_back(v);
+        if ((int)values.size() < n * n) {
+            cerr << "Truncated puzzle at end of input." << endl;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+template <int N>
+bool solve_sized(vector<int>& values, Engine engine) {
+    int grid[N][N];
+    for (int k = 0; k < N * N; k++) grid[k / N][k % N] = values[k];
+
+    bool ok;
+    switch (engine) {
+    case ENGINE_SERIAL: ok = solve_grid_serial(grid); break;
+    case ENGINE_DLX: ok = solve_grid_dlx(grid); break;
+    default: ok = solve_simd_grid(grid); break;
+    }
+
+    if (ok) {
+        for (int k = 0; k < N * N; k++) values[k] = grid[k / N][k % N];
+    }
+    return ok;
+}
+
+// Pick the instantiation for this puzzle's size
+bool solve_any(int n, vector<int>& values, Engine engine) {
+    switch (n) {
+    case 4: return solve_sized<4>(values, engine);
+    case 9: return solve_sized<9>(values, engine);
+    case 16: return solve_sized<16>(values, engine);
+    case 25: return solve_sized<25>(values, engine);
+    case 36: return solve_sized<36>(values, engine);
+    default:
+        cerr << "Unsupported board size " << n << "x" << n << "." << endl;
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_solver_options(argc, argv);
+    if (has_flag(argc, argv, "--stats")) cerr << "simd isa: " << simd_isa_names[simd_isa] << endl;
+
+    // --engine serial|simd|dlx (default simd)
+    Engine engine = ENGINE_SIMD;
+    if (const char* name = option_value(argc, argv, "--engine")) {
+        if (strcmp(name, "serial") == 0) engine = ENGINE_SERIAL;
+        else if (strcmp(name, "dlx") == 0) engine = ENGINE_DLX;
+        else if (strcmp(name, "simd") != 0) cerr << "Unknown engine " << name << ", using simd." << endl;
+    }
+
+    int n;
+    vector<int> values;
+    if (!has_flag(argc, argv, "--batch")) {
+        if (!read_any_grid(cin, n, values)) return 0;
+
+        auto start = chrono::high_resolution_clock::now();
+        if (solve_any(n, values, engine)) {
+            auto end = chrono::high_resolution_clock::now();
+            chrono::duration<double, std::milli> elapsed = end - start;
+            cout << elapsed.count() << " ms" << endl;
+        } else {
+            cout << "No solution found." << endl;
+        }
+        return 0;
+    }
+
+    // Same output contract as run_batch, with puzzles of any supported size
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    long long total = 0, solved = 0;
+    double solve_ms = 0.0;
+
+    auto batch_start = chrono::high_resolution_clock::now();
+    while (read_any_grid(cin, n, values)) {
+        auto start = chrono::high_resolution_clock::now();
+        bool ok = solve_any(n, values, engine);
+        auto end = chrono::high_resolution_clock::now();
+        chrono::duration<double, std::milli> elapsed = end - start;
+        solve_ms += elapsed.count();
+        total++;
+
+        if (ok) {
+            solved++;
+            cout << elapsed.count() << " ms";
+            for (int v : values) cout << ' ' << v;
+            cout << '\n';
+        } else {
+            cout << "No solution found.\n";
+        }
+    }
+    cout.flush();
+    auto batch_end = chrono::high_resolution_clock::now();
+    chrono::duration<double, std::milli> wall = batch_end - batch_start;
+
+    print_summary(total, solved, solve_ms, wall.count());
+    return 0;
+}
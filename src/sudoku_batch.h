@@ -0,0 +1,184 @@
+#ifndef SUDOKU_BATCH_H
+#define SUDOKU_BATCH_H
+
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include "sudoku_common.h"
+
+#ifndef BATCH_CHUNK
+#define BATCH_CHUNK 4096
+#endif
+
+// --- Streaming (batch) mode ---
+// Input: any number of N x N puzzles, whitespace separated, back to back.
+// Output: one line per puzzle, either
+//     "<time> ms <N*N solution values, row-major>"
+// or  "No solution found."
+// A summary (puzzles, solved, throughput) goes to stderr so stdout stays
+// machine-readable.
+
+inline bool has_flag(int argc, char* argv[], const char* flag) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) return true;
+    }
+    return false;
+}
+
+// Value of "--name value" or "--name=value", or nullptr if absent
+inline const char* option_value(int argc, char* argv[], const char* name) {
+    size_t len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], name, len) != 0) continue;
+        if (argv[i][len] == '=') return argv[i] + len + 1;
+        if (argv[i][len] == '\0' && i + 1 < argc) return argv[i + 1];
+    }
+    return nullptr;
+}
+
+inline int int_option(int argc, char* argv[], const char* name, int fallback) {
+    const char* value = option_value(argc, argv, name);
+    return value ? atoi(value) : fallback;
+}
+
+// Options shared by every solver binary:
+//   --prop-level K   inference run at every search node (0-3, see prop_level)
+//   --value-order O  asc|desc|lcv|freq, the order candidates are tried in
+//   --stats          print per-rule and node counters (and, for the parallel
+//                    searches, cancellation latency) to stderr on exit
+inline void parse_solver_options(int argc, char* argv[]) {
+    prop_level = int_option(argc, argv, "--prop-level", prop_level);
+    if (const char* name = option_value(argc, argv, "--value-order")) {
+        if (!parse_value_order(name, value_order)) cerr << "Unknown value order " << name << ", using asc." << endl;
+    }
+    if (has_flag(argc, argv, "--stats")) {
+        atexit([] {
+            print_prop_stats(cerr);
+            print_quiescence_stats(cerr);
+        });
+    }
+}
+
+// Read one puzzle. Returns false on clean EOF or on a truncated puzzle.
+template <int N>
+inline bool read_grid(istream& in, int grid[N][N]) {
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            if (!(in >> grid[i][j])) {
+                if (i != 0 || j != 0) cerr << "Truncated puzzle at end of input." << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <int N>
+inline void print_result(ostream& out, int grid[N][N], double elapsed_ms) {
+    out << elapsed_ms << " ms";
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            out << ' ' << grid[i][j];
+        }
+    }
+    out << '\n';
+}
+
+inline void print_summary(long long total, long long solved, double solve_ms, double wall_ms) {
+    cerr << "batch: " << solved << "/" << total << " solved, "
+         << solve_ms << " ms solving, " << wall_ms << " ms wall";
+    if (wall_ms > 0) cerr << ", " << (total * 1000.0 / wall_ms) << " puzzles/s";
+    cerr << endl;
+}
+
+// Solve every puzzle on stdin with `solve`, which must leave the solution
+// in the grid it is given and return whether one was found.
+template <int N, class Solver>
+int run_batch(Solver solve) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    int grid[N][N];
+    long long total = 0, solved = 0;
+    double solve_ms = 0.0;
+
+    auto batch_start = chrono::high_resolution_clock::now();
+    while (read_grid(cin, grid)) {
+        auto start = chrono::high_resolution_clock::now();
+        bool ok = solve(grid);
+        auto end = chrono::high_resolution_clock::now();
+        chrono::duration<double, std::milli> elapsed = end - start;
+        solve_ms += elapsed.count();
+        total++;
+
+        if (ok) {
+            solved++;
+            print_result(cout, grid, elapsed.count());
+        } else {
+            cout << "No solution found.\n";
+        }
+    }
+    cout.flush();
+    auto batch_end = chrono::high_resolution_clock::now();
+    chrono::duration<double, std::milli> wall = batch_end - batch_start;
+
+    print_summary(total, solved, solve_ms, wall.count());
+    return 0;
+}
+
+// Inter-puzzle parallel batch: puzzles are read in chunks of BATCH_CHUNK and
+// whole puzzles are spread over the OpenMP team, each thread running the
+// serial engine `solve` on its own grid. Results are printed in input order.
+// This is the right shape for many small puzzles, where splitting a single
+// search tree into tasks costs more than it saves.
+template <int N, class Solver>
+int run_batch_parallel(Solver solve) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    struct BatchItem {
+        int grid[N][N];
+        double elapsed_ms;
+        bool ok;
+    };
+    vector<BatchItem> items(BATCH_CHUNK);
+    long long total = 0, solved = 0;
+    double solve_ms = 0.0;
+
+    auto batch_start = chrono::high_resolution_clock::now();
+    bool more = true;
+    while (more) {
+        int count = 0;
+        while (count < BATCH_CHUNK && (more = read_grid(cin, items[count].grid))) count++;
+        if (count == 0) break;
+
+        long long chunk_solved = 0;
+        double chunk_ms = 0.0;
+        #pragma omp parallel for schedule(dynamic) reduction(+:chunk_solved, chunk_ms)
+        for (int i = 0; i < count; i++) {
+            BatchItem& item = items[i];
+            auto start = chrono::high_resolution_clock::now();
+            item.ok = solve(item.grid);
+            auto end = chrono::high_resolution_clock::now();
+            item.elapsed_ms = chrono::duration<double, std::milli>(end - start).count();
+            chunk_ms += item.elapsed_ms;
+            if (item.ok) chunk_solved++;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (items[i].ok) print_result(cout, items[i].grid, items[i].elapsed_ms);
+            else cout << "No solution found.\n";
+        }
+        total += count;
+        solved += chunk_solved;
+        solve_ms += chunk_ms;
+    }
+    cout.flush();
+    auto batch_end = chrono::high_resolution_clock::now();
+    chrono::duration<double, std::milli> wall = batch_end - batch_start;
+
+    print_summary(total, solved, solve_ms, wall.count());
+    return 0;
+}
+
+#endif
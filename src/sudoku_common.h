@@ -6,91 +6,596 @@
 #include <algorithm>
 #include <cstring>
 #include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include <mutex>
+#include <atomic>
 
 using namespace std;
 
-#ifndef N
-#define N 9
+// Default board size of the single-size executables (-DBOARD_N=16 etc.).
+// The solvers themselves are templates over N, the side length, and are
+// instantiated for whatever sizes a binary asks for.
+#ifndef BOARD_N
+#define BOARD_N 9
 #endif
 
-#ifndef SQRT_N
-#define SQRT_N 3
-#endif
+constexpr int isqrt(int n) {
+    int s = 0;
+    while ((s + 1) * (s + 1) <= n) s++;
+    return s;
+}
+
+// Box side of an N x N board
+template <int N> constexpr int sqrt_n = isqrt(N);
+
+template <int N>
+inline int box_of(int r, int c) {
+    return (r / sqrt_n<N>) * sqrt_n<N> + c / sqrt_n<N>;
+}
+
+// One byte per cell, and the narrowest mask that holds N digits: 16 bits up
+// to 16x16, 32 bits up to 32x32 (25x25), 64 bits beyond (36x36). The board is
+// copied into every OpenMP task, so its size is the task-creation cost.
+typedef uint8_t cell_t;
+template <int N> using mask_t =
+    typename conditional<(N <= 16), uint16_t, typename conditional<(N <= 32), uint32_t, uint64_t>::type>::type;
+
+// One bit per digit, and the bit of a single digit (1-based)
+template <int N> constexpr mask_t<N> full_mask = (mask_t<N>)(~0ULL >> (64 - N));
+
+template <int N>
+inline mask_t<N> digit_bit(int val) {
+    return (mask_t<N>)((mask_t<N>)1 << (val - 1));
+}
+
+// Bit scans that work for every mask width
+inline int mask_ctz(uint64_t m) { return __builtin_ctzll(m); }
+inline int mask_popcount(uint64_t m) { return __builtin_popcountll(m); }
+
+// Board plus the digits already used in each row, column and box.
+// The masks are updated on every place/unplace, so a candidate query is
+// three ORs instead of a rescan of the row, column and box.
+template <int N>
+struct SudokuBoard {
+    static_assert(sqrt_n<N> * sqrt_n<N> == N, "board side must be a perfect square");
+    static_assert(N <= 64, "masks are at most 64 bits");
+    cell_t grid[N][N];
+    mask_t<N> row_mask[N];
+    mask_t<N> col_mask[N];
+    mask_t<N> box_mask[N];
+};
+
+template <int N>
+inline void place(SudokuBoard<N>& b, int r, int c, int val) {
+    mask_t<N> bit = digit_bit<N>(val);
+    b.grid[r][c] = (cell_t)val;
+    b.row_mask[r] |= bit;
+    b.col_mask[c] |= bit;
+    b.box_mask[box_of<N>(r, c)] |= bit;
+}
+
+template <int N>
+inline void unplace(SudokuBoard<N>& b, int r, int c) {
+    mask_t<N> bit = digit_bit<N>(b.grid[r][c]);
+    b.grid[r][c] = 0;
+    b.row_mask[r] ^= bit;
+    b.col_mask[c] ^= bit;
+    b.box_mask[box_of<N>(r, c)] ^= bit;
+}
+
+// Undo log: the cells written since the search started, in order. Rolling
+// back to a mark unplaces only those cells, so backtracking costs what the
+// node changed instead of a full board copy.
+template <int N>
+struct Trail {
+    int cells[N * N]; // r * N + c
+    int size = 0;
+};
+
+// Trail pointer as a non-deduced parameter, so callers can pass nullptr
+template <int N> using trail_ptr = typename enable_if<true, Trail<N>*>::type;
+
+template <int N>
+inline void place(SudokuBoard<N>& b, trail_ptr<N> trail, int r, int c, int val) {
+    place(b, r, c, val);
+    if (trail) trail->cells[trail->size++] = r * N + c;
+}
+
+template <int N>
+inline void undo_to(SudokuBoard<N>& b, Trail<N>& trail, int mark) {
+    while (trail.size > mark) {
+        int cell = trail.cells[--trail.size];
+        unplace(b, cell / N, cell % N);
+    }
+}
+
+// Build the board from a plain grid. Returns false if the givens are out of
+// range or already conflict with each other.
+template <int N>
+inline bool init_board(SudokuBoard<N>& b, int grid[N][N]) {
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            int val = grid[i][j];
+            if (val == 0) continue;
+            if (val < 0 || val > N) return false;
+            mask_t<N> bit = digit_bit<N>(val);
+            if ((b.row_mask[i] | b.col_mask[j] | b.box_mask[box_of<N>(i, j)]) & bit) return false;
+            place(b, i, j, val);
+        }
+    }
+    return true;
+}
+
+template <int N>
+inline void board_to_grid(const SudokuBoard<N>& b, int grid[N][N]) {
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            grid[i][j] = b.grid[i][j];
+        }
+    }
+}
+
+// Possible values for a cell
+template <int N>
+inline mask_t<N> get_candidates(const SudokuBoard<N>& b, int r, int c) {
+    return (mask_t<N>)(full_mask<N> & ~(b.row_mask[r] | b.col_mask[c] | b.box_mask[box_of<N>(r, c)]));
+}
+
+// --- Propagation pipeline ---
+// prop_level selects how much inference runs at every search node:
+//   0  naked singles only (the cheap path, enough for easy puzzles)
+//   1  + hidden singles in every row, column and box
+//   2  + naked pairs and hidden pairs
+//   3  + box-line reduction (pointing pairs and claiming)
+// Levels above 0 work on the node's candidate grid. Eliminations are not
+// stored in the board; children re-derive them from their own masks.
+inline int prop_level = 0;
+
+// A thread may search at its own level (the portfolio races configurations
+// that differ in it); -1 follows prop_level.
+inline thread_local int thread_prop_level = -1;
+
+inline int active_prop_level() {
+    return thread_prop_level >= 0 ? thread_prop_level : prop_level;
+}
+
+enum PropRule {
+    RULE_NAKED_SINGLE,
+    RULE_HIDDEN_SINGLE,
+    RULE_NAKED_PAIR,
+    RULE_HIDDEN_PAIR,
+    RULE_BOX_LINE,
+    RULE_COUNT
+};
+
+static const char* const prop_rule_names[RULE_COUNT] = {
+    "naked_single", "hidden_single", "naked_pair", "hidden_pair", "box_line"
+};
+
+// How many times each rule made progress, and how many search nodes were
+// expanded. One instance per thread so the counters stay uncontended.
+struct PropStats {
+    long long fired[RULE_COUNT] = {};
+    long long nodes = 0;
+};
+
+inline mutex prop_stats_mutex;
+inline vector<PropStats*> prop_stats_registry;
+
+inline PropStats& thread_prop_stats() {
+    // Never freed: totals are read after the worker threads go idle
+    thread_local PropStats* stats = nullptr;
+    if (!stats) {
+        stats = new PropStats();
+        lock_guard<mutex> lock(prop_stats_mutex);
+        prop_stats_registry.push_back(stats);
+    }
+    return *stats;
+}
+
+inline void print_prop_stats(ostream& out) {
+    PropStats total;
+    {
+        lock_guard<mutex> lock(prop_stats_mutex);
+        for (PropStats* s : prop_stats_registry) {
+            for (int r = 0; r < RULE_COUNT; r++) total.fired[r] += s->fired[r];
+            total.nodes += s->nodes;
+        }
+    }
+    out << "propagation level " << prop_level << ": nodes=" << total.nodes;
+    for (int r = 0; r < RULE_COUNT; r++) out << " " << prop_rule_names[r] << "=" << total.fired[r];
+    out << endl;
+}
+
+// Cooperative cancellation for the parallel searches. Engines poll
+// cancelled() once per node (a relaxed load of a flag that only changes
+// once), and the first cancel() wins and stamps the time, so the caller can
+// measure how long the team took to go quiet after the first solution.
+struct CancelToken {
+    atomic<bool> flag{false};
+    chrono::high_resolution_clock::time_point fired_at;
+
+    bool cancelled() const { return flag.load(memory_order_relaxed); }
+
+    // True for the caller that actually fired the token
+    bool cancel() {
+        if (flag.load(memory_order_relaxed)) return false;
+        auto now = chrono::high_resolution_clock::now();
+        bool expected = false;
+        if (!flag.compare_exchange_strong(expected, true, memory_order_acq_rel)) return false;
+        fired_at = now;
+        return true;
+    }
 
-// Helper to get possible values for a cell
-inline int get_candidates(int grid[N][N], int r, int c) {
-    int used = 0;
+    void reset() { flag.store(false, memory_order_relaxed); }
+};
+
+// Time from cancel() to the end of the parallel region, over every search
+// that was cancelled. Recorded by the thread that joins the team.
+struct QuiescenceStats {
+    long long count = 0;
+    double total_us = 0.0;
+    double max_us = 0.0;
+};
+
+inline QuiescenceStats quiescence_stats;
+
+inline void record_quiescence(const CancelToken& token) {
+    if (!token.flag.load(memory_order_acquire)) return;
+    auto now = chrono::high_resolution_clock::now();
+    double us = chrono::duration<double, std::micro>(now - token.fired_at).count();
+    quiescence_stats.count++;
+    quiescence_stats.total_us += us;
+    quiescence_stats.max_us = max(quiescence_stats.max_us, us);
+}
+
+inline void print_quiescence_stats(ostream& out) {
+    if (quiescence_stats.count == 0) return;
+    out << "cancel: " << quiescence_stats.count << " searches, solution to quiescence avg "
+        << quiescence_stats.total_us / quiescence_stats.count << " us, max "
+        << quiescence_stats.max_us << " us" << endl;
+}
+
+// Cells of every unit as r * N + c: rows are units 0..N-1, columns N..2N-1,
+// boxes 2N..3N-1.
+template <int N>
+struct UnitTable {
+    int cells[3 * N][N];
+    UnitTable() {
+        for (int u = 0; u < N; u++) {
+            for (int k = 0; k < N; k++) {
+                cells[u][k] = u * N + k;
+                cells[N + u][k] = k * N + u;
+                int r = (u / sqrt_n<N>) * sqrt_n<N> + k / sqrt_n<N>;
+                int c = (u % sqrt_n<N>) * sqrt_n<N> + k % sqrt_n<N>;
+                cells[2 * N + u][k] = r * N + c;
+            }
+        }
+    }
+};
+template <int N> inline const UnitTable<N> units{};
+
+// Peers of every cell as r * N + c: the rest of its row, its column, then
+// the box cells outside both
+template <int N>
+struct PeerTable {
+    static constexpr int COUNT = 3 * N - 2 * sqrt_n<N> - 1;
+    int cells[N * N][COUNT];
+    PeerTable() {
+        for (int cell = 0; cell < N * N; cell++) {
+            int r = cell / N, c = cell % N, k = 0;
+            for (int j = 0; j < N; j++) {
+                if (j != c) cells[cell][k++] = r * N + j;
+            }
+            for (int i = 0; i < N; i++) {
+                if (i != r) cells[cell][k++] = i * N + c;
+            }
+            int br = r - r % sqrt_n<N>, bc = c - c % sqrt_n<N>;
+            for (int i = br; i < br + sqrt_n<N>; i++) {
+                for (int j = bc; j < bc + sqrt_n<N>; j++) {
+                    if (i != r && j != c) cells[cell][k++] = i * N + j;
+                }
+            }
+        }
+    }
+};
+template <int N> inline const PeerTable<N> peers{};
+
+template <int N>
+inline mask_t<N> unit_used(const SudokuBoard<N>& b, int u) {
+    if (u < N) return b.row_mask[u];
+    if (u < 2 * N) return b.col_mask[u - N];
+    return b.box_mask[u - 2 * N];
+}
+
+template <int N>
+inline void fill_candidates(const SudokuBoard<N>& b, mask_t<N> cand[N][N]) {
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            cand[i][j] = b.grid[i][j] ? 0 : get_candidates(b, i, j);
+        }
+    }
+}
+
+// Place a value and remove it from the candidates of the cell's peers
+template <int N>
+inline void assign(SudokuBoard<N>& b, trail_ptr<N> trail, mask_t<N> cand[N][N], int r, int c, int val) {
+    mask_t<N> bit = digit_bit<N>(val);
+    place(b, trail, r, c, val);
+    cand[r][c] = 0;
     for (int k = 0; k < N; k++) {
-        if (grid[r][k] != 0) used |= (1 << (grid[r][k] - 1));
-        if (grid[k][c] != 0) used |= (1 << (grid[k][c] - 1));
+        cand[r][k] &= ~bit;
+        cand[k][c] &= ~bit;
+    }
+    int br = (r / sqrt_n<N>) * sqrt_n<N>, bc = (c / sqrt_n<N>) * sqrt_n<N>;
+    for (int i = 0; i < sqrt_n<N>; i++) {
+        for (int j = 0; j < sqrt_n<N>; j++) {
+            cand[br + i][bc + j] &= ~bit;
+        }
+    }
+}
+
+// Remove bits from a cell's candidates; true if anything was removed
+template <int N>
+inline bool eliminate(mask_t<N> cand[N][N], int cell, mask_t<N> bits) {
+    mask_t<N>& m = cand[cell / N][cell % N];
+    if (!(m & bits)) return false;
+    m &= ~bits;
+    return true;
+}
+
+// Rule passes return -1 on a contradiction, 1 on progress, 0 otherwise.
+
+template <int N>
+inline int apply_naked_singles(SudokuBoard<N>& b, trail_ptr<N> trail, mask_t<N> cand[N][N]) {
+    int progress = 0;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            if (b.grid[i][j] != 0) continue;
+            mask_t<N> m = cand[i][j];
+            if (m == 0) return -1;
+            if ((m & (m - 1)) == 0) {
+                assign(b, trail, cand, i, j, mask_ctz(m) + 1);
+                thread_prop_stats().fired[RULE_NAKED_SINGLE]++;
+                progress = 1;
+            }
+        }
+    }
+    return progress;
+}
+
+// A digit that fits only one cell of a unit goes there
+template <int N>
+inline int apply_hidden_singles(SudokuBoard<N>& b, trail_ptr<N> trail, mask_t<N> cand[N][N]) {
+    int progress = 0;
+    for (int u = 0; u < 3 * N; u++) {
+        mask_t<N> once = 0, twice = 0;
+        for (int k = 0; k < N; k++) {
+            int cell = units<N>.cells[u][k];
+            mask_t<N> m = cand[cell / N][cell % N];
+            twice |= once & m;
+            once |= m;
+        }
+        if ((once | unit_used(b, u)) != (mask_t<N>)full_mask<N>) return -1; // a digit has nowhere to go
+        mask_t<N> hidden = once & ~twice;
+        if (!hidden) continue;
+        for (int k = 0; k < N && hidden; k++) {
+            int cell = units<N>.cells[u][k];
+            mask_t<N> m = cand[cell / N][cell % N] & hidden;
+            if (!m) continue;
+            if (m & (m - 1)) return -1; // one cell would need two digits
+            hidden &= ~m;
+            assign(b, trail, cand, cell / N, cell % N, mask_ctz(m) + 1);
+            thread_prop_stats().fired[RULE_HIDDEN_SINGLE]++;
+            progress = 1;
+        }
+    }
+    return progress;
+}
+
+// Two cells of a unit with the same two candidates own those digits
+template <int N>
+inline int apply_naked_pairs(mask_t<N> cand[N][N]) {
+    int progress = 0;
+    for (int u = 0; u < 3 * N; u++) {
+        for (int k1 = 0; k1 < N; k1++) {
+            int c1 = units<N>.cells[u][k1];
+            mask_t<N> m = cand[c1 / N][c1 % N];
+            if (mask_popcount(m) != 2) continue;
+            for (int k2 = k1 + 1; k2 < N; k2++) {
+                int c2 = units<N>.cells[u][k2];
+                if (cand[c2 / N][c2 % N] != m) continue;
+                bool changed = false;
+                for (int k = 0; k < N; k++) {
+                    if (k == k1 || k == k2) continue;
+                    changed |= eliminate(cand, units<N>.cells[u][k], m);
+                }
+                if (changed) {
+                    thread_prop_stats().fired[RULE_NAKED_PAIR]++;
+                    progress = 1;
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+// Two digits confined to the same two cells of a unit: those cells hold
+// nothing else
+template <int N>
+inline int apply_hidden_pairs(mask_t<N> cand[N][N]) {
+    int progress = 0;
+    uint64_t where[N];
+    for (int u = 0; u < 3 * N; u++) {
+        for (int d = 0; d < N; d++) where[d] = 0;
+        for (int k = 0; k < N; k++) {
+            int cell = units<N>.cells[u][k];
+            mask_t<N> m = cand[cell / N][cell % N];
+            while (m) {
+                where[mask_ctz(m)] |= 1ULL << k;
+                m &= m - 1;
+            }
+        }
+        for (int d1 = 0; d1 < N; d1++) {
+            if (__builtin_popcountll(where[d1]) != 2) continue;
+            for (int d2 = d1 + 1; d2 < N; d2++) {
+                if (where[d2] != where[d1]) continue;
+                mask_t<N> keep = (mask_t<N>)(digit_bit<N>(d1 + 1) | digit_bit<N>(d2 + 1));
+                bool changed = false;
+                for (uint64_t pos = where[d1]; pos; pos &= pos - 1) {
+                    changed |= eliminate(cand, units<N>.cells[u][__builtin_ctzll(pos)], (mask_t<N>)~keep);
+                }
+                if (changed) {
+                    thread_prop_stats().fired[RULE_HIDDEN_PAIR]++;
+                    progress = 1;
+                }
+            }
+        }
     }
-    int br = (r / SQRT_N) * SQRT_N;
-    int bc = (c / SQRT_N) * SQRT_N;
-    for (int i = 0; i < SQRT_N; i++) {
-        for (int j = 0; j < SQRT_N; j++) {
-            int val = grid[br + i][bc + j];
-            if (val != 0) used |= (1 << (val - 1));
+    return progress;
+}
+
+// Box-line reduction: a digit confined to one line inside a box is removed
+// from the rest of that line (pointing), and a digit confined to one box
+// inside a line is removed from the rest of that box (claiming).
+template <int N>
+inline int apply_box_line(mask_t<N> cand[N][N]) {
+    int progress = 0;
+    for (int box = 0; box < N; box++) {
+        int br = (box / sqrt_n<N>) * sqrt_n<N>, bc = (box % sqrt_n<N>) * sqrt_n<N>;
+        for (int d = 0; d < N; d++) {
+            mask_t<N> bit = digit_bit<N>(d + 1);
+            int rows = 0, cols = 0; // which rows / columns of the box hold d
+            for (int i = 0; i < sqrt_n<N>; i++) {
+                for (int j = 0; j < sqrt_n<N>; j++) {
+                    if (cand[br + i][bc + j] & bit) {
+                        rows |= 1 << i;
+                        cols |= 1 << j;
+                    }
+                }
+            }
+            bool changed = false;
+            if (rows && (rows & (rows - 1)) == 0) {
+                int r = br + __builtin_ctz(rows);
+                for (int c = 0; c < N; c++) {
+                    if (c < bc || c >= bc + sqrt_n<N>) changed |= eliminate(cand, r * N + c, bit);
+                }
+            }
+            if (cols && (cols & (cols - 1)) == 0) {
+                int c = bc + __builtin_ctz(cols);
+                for (int r = 0; r < N; r++) {
+                    if (r < br || r >= br + sqrt_n<N>) changed |= eliminate(cand, r * N + c, bit);
+                }
+            }
+            // Claiming: the box's row (column) is the only place d fits in that line
+            for (int i = 0; i < sqrt_n<N>; i++) {
+                if (!(rows & (1 << i))) continue;
+                int r = br + i;
+                bool outside = false;
+                for (int c = 0; c < N && !outside; c++) {
+                    if ((c < bc || c >= bc + sqrt_n<N>) && (cand[r][c] & bit)) outside = true;
+                }
+                if (outside) continue;
+                for (int i2 = 0; i2 < sqrt_n<N>; i2++) {
+                    if (i2 == i) continue;
+                    for (int j = 0; j < sqrt_n<N>; j++) changed |= eliminate(cand, (br + i2) * N + bc + j, bit);
+                }
+            }
+            for (int j = 0; j < sqrt_n<N>; j++) {
+                if (!(cols & (1 << j))) continue;
+                int c = bc + j;
+                bool outside = false;
+                for (int r = 0; r < N && !outside; r++) {
+                    if ((r < br || r >= br + sqrt_n<N>) && (cand[r][c] & bit)) outside = true;
+                }
+                if (outside) continue;
+                for (int j2 = 0; j2 < sqrt_n<N>; j2++) {
+                    if (j2 == j) continue;
+                    for (int i = 0; i < sqrt_n<N>; i++) changed |= eliminate(cand, (br + i) * N + bc + j2, bit);
+                }
+            }
+            if (changed) {
+                thread_prop_stats().fired[RULE_BOX_LINE]++;
+                progress = 1;
+            }
         }
     }
-    return used ^ ((1 << N) - 1);
+    return progress;
+}
+
+// Run the rules enabled by prop_level to a fixpoint, cheapest first: a
+// rule only runs when every cheaper rule is stuck. cand must hold the exact
+// candidates of the board on entry and holds the refined ones on return.
+template <int N>
+inline bool propagate_rules(SudokuBoard<N>& b, trail_ptr<N> trail, mask_t<N> cand[N][N]) {
+    const int level = active_prop_level();
+    while (true) {
+        int r = apply_naked_singles(b, trail, cand);
+        if (r < 0) return false;
+        if (r > 0) continue;
+        if (level < 1) break;
+
+        r = apply_hidden_singles(b, trail, cand);
+        if (r < 0) return false;
+        if (r > 0) continue;
+        if (level < 2) break;
+
+        if (apply_naked_pairs(cand) > 0) continue;
+        if (apply_hidden_pairs(cand) > 0) continue;
+        if (level < 3) break;
+
+        if (apply_box_line(cand) > 0) continue;
+        break;
+    }
+    return true;
 }
 
-// Propagate constraints: fill naked singles
-inline bool propagate(int grid[N][N]) {
+// Propagate constraints: fill naked singles, then run the higher rules if
+// prop_level asks for them. Writes are logged to trail if given. On success
+// cand holds the candidates of every empty cell.
+template <int N>
+inline bool propagate(SudokuBoard<N>& b, trail_ptr<N> trail, mask_t<N> cand[N][N]) {
     bool changed = true;
     while (changed) {
         changed = false;
         for (int i = 0; i < N; i++) {
             for (int j = 0; j < N; j++) {
-                if (grid[i][j] == 0) {
-                    int candidates = get_candidates(grid, i, j);
+                if (b.grid[i][j] == 0) {
+                    mask_t<N> candidates = get_candidates(b, i, j);
                     if (candidates == 0) return false;
-                    
+
                     if ((candidates & (candidates - 1)) == 0) {
-                        int val = 0;
-                        while ((candidates & 1) == 0) {
-                            candidates >>= 1;
-                            val++;
-                        }
-                        grid[i][j] = val + 1;
+                        place(b, trail, i, j, mask_ctz(candidates) + 1);
+                        thread_prop_stats().fired[RULE_NAKED_SINGLE]++;
+                        candidates = 0;
                         changed = true;
                     }
+                    cand[i][j] = candidates;
+                } else {
+                    cand[i][j] = 0;
                 }
             }
         }
     }
-    return true;
+    if (active_prop_level() == 0) return true;
+    return propagate_rules(b, trail, cand);
 }
 
-// Serial solve function (backtracking with MRV)
-inline bool solve_serial(int grid[N][N]) {
-    int backup[N][N];
-    memcpy(backup, grid, sizeof(backup));
-
-    if (!propagate(grid)) {
-        memcpy(grid, backup, sizeof(backup));
-        return false;
-    }
-
+// MRV over a candidate grid. Returns false if an empty cell has no
+// candidates; otherwise best_r is -1 when the board is full.
+template <int N>
+inline bool find_mrv(const SudokuBoard<N>& b, mask_t<N> cand[N][N], int& best_r, int& best_c, mask_t<N>& best_mask) {
     int min_candidates = N + 1;
-    int best_r = -1, best_c = -1;
-    int best_mask = 0;
-
-    bool solved = true;
+    best_r = -1;
     for (int i = 0; i < N; i++) {
         for (int j = 0; j < N; j++) {
-            if (grid[i][j] == 0) {
-                solved = false;
-                int mask = get_candidates(grid, i, j);
-                if (mask == 0) {
-                    memcpy(grid, backup, sizeof(backup));
-                    return false;
-                }
-                
-                int count = 0;
-                int temp = mask;
-                while (temp) { temp &= (temp - 1); count++; }
+            if (b.grid[i][j] == 0) {
+                mask_t<N> mask = cand[i][j];
+                if (mask == 0) return false;
 
+                int count = mask_popcount(mask);
                 if (count < min_candidates) {
                     min_candidates = count;
                     best_r = i;
@@ -100,18 +605,303 @@ inline bool solve_serial(int grid[N][N]) {
             }
         }
     }
+    return true;
+}
 
-    if (solved) return true;
+// Naked singles to a fixpoint with the MRV pick folded into the sweeps, for
+// prop_level 0. The last sweep places nothing, so its minimum is the cell
+// find_mrv would pick, without a second pass over the board.
+template <int N>
+inline bool propagate_singles_and_pick(SudokuBoard<N>& b, trail_ptr<N> trail, int& best_r, int& best_c, mask_t<N>& best_mask) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        int min_candidates = N + 1;
+        best_r = -1;
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                if (b.grid[i][j] != 0) continue;
+                mask_t<N> candidates = get_candidates(b, i, j);
+                if (candidates == 0) return false;
 
-    for (int val = 1; val <= N; val++) {
-        if (best_mask & (1 << (val - 1))) {
-            grid[best_r][best_c] = val;
-            if (solve_serial(grid)) return true;
+                if ((candidates & (candidates - 1)) == 0) {
+                    place(b, trail, i, j, mask_ctz(candidates) + 1);
+                    thread_prop_stats().fired[RULE_NAKED_SINGLE]++;
+                    changed = true;
+                    continue;
+                }
+                int count = mask_popcount(candidates);
+                if (count < min_candidates) {
+                    min_candidates = count;
+                    best_r = i;
+                    best_c = j;
+                    best_mask = candidates;
+                }
+            }
         }
     }
+    return true;
+}
+
+// One search node: propagate, then pick the branching cell. Returns false on
+// a contradiction; best_r is -1 when the board is solved.
+template <int N>
+inline bool propagate_and_pick(SudokuBoard<N>& b, trail_ptr<N> trail, int& best_r, int& best_c, mask_t<N>& best_mask) {
+    thread_prop_stats().nodes++;
+    if (active_prop_level() == 0) return propagate_singles_and_pick(b, trail, best_r, best_c, best_mask);
+    mask_t<N> cand[N][N];
+    if (!propagate(b, trail, cand)) return false;
+    return find_mrv(b, cand, best_r, best_c, best_mask);
+}
+
+// --- Value ordering (--value-order) ---
+// Order in which the candidates of the branching cell are tried. It does not
+// change the work on an unsatisfiable subtree, but on a satisfiable one the
+// first solution arrives sooner when the likely value goes first:
+//   asc   1..N (the old behaviour)
+//   desc  N..1
+//   lcv   least-constraining value: fewest empty peers that still have the
+//         value as a candidate, so the placement leaves the most options
+//   freq  the digits already placed most often first; they have the fewest
+//         free positions left, so a wrong guess fails fast
+// VALUES_RANDOM needs a generator and is only used by the portfolio.
+enum ValueOrder { VALUES_ASCENDING, VALUES_DESCENDING, VALUES_LCV, VALUES_FREQUENCY, VALUES_RANDOM };
 
-    memcpy(grid, backup, sizeof(backup)); 
+inline ValueOrder value_order = VALUES_ASCENDING;
+
+inline bool parse_value_order(const char* name, ValueOrder& order) {
+    if (strcmp(name, "asc") == 0) order = VALUES_ASCENDING;
+    else if (strcmp(name, "desc") == 0) order = VALUES_DESCENDING;
+    else if (strcmp(name, "lcv") == 0) order = VALUES_LCV;
+    else if (strcmp(name, "freq") == 0) order = VALUES_FREQUENCY;
+    else return false;
+    return true;
+}
+
+// Write the candidates in mask to values in the given order; returns how
+// many there are. Lower scores go first, ties stay ascending.
+template <int N>
+inline int order_values(const SudokuBoard<N>& b, int r, int c, mask_t<N> mask, ValueOrder order, int values[N]) {
+    int count = 0;
+    for (mask_t<N> m = mask; m; m &= m - 1) values[count++] = mask_ctz(m) + 1;
+    if (order == VALUES_DESCENDING) reverse(values, values + count);
+    if (count < 2 || (order != VALUES_LCV && order != VALUES_FREQUENCY)) return count;
+
+    int score[N + 1] = {};
+    if (order == VALUES_LCV) {
+        for (int p : peers<N>.cells[r * N + c]) {
+            int i = p / N, j = p % N;
+            if (b.grid[i][j] != 0) continue;
+            for (mask_t<N> m = get_candidates(b, i, j) & mask; m; m &= m - 1) score[mask_ctz(m) + 1]++;
+        }
+    } else {
+        for (int k = 0; k < count; k++) {
+            mask_t<N> bit = digit_bit<N>(values[k]);
+            for (int i = 0; i < N; i++) {
+                if (b.row_mask[i] & bit) score[values[k]]--;
+            }
+        }
+    }
+
+    // Insertion sort: count is the MRV cell's candidate count, usually 2-3
+    for (int k = 1; k < count; k++) {
+        int v = values[k], j = k;
+        for (; j > 0 && score[values[j - 1]] > score[v]; j--) values[j] = values[j - 1];
+        values[j] = v;
+    }
+    return count;
+}
+
+// --- MRV buckets ---
+// At prop_level 0 the serial search needs no sweep over the board. Every
+// empty cell keeps its candidate mask and sits in a doubly linked list by
+// candidate count; bit k of nonempty says whether bucket k has a cell. A
+// placement can only take a candidate from the cell's peers, so assign
+// touches PeerTable::COUNT masks and moves the peers that lost the value
+// down one bucket, logging them so the undo puts back exactly those.
+// Bucket 0 is a contradiction, bucket 1 holds the naked singles, and the MRV
+// cell is the head of the lowest bucket; each is one test or ctz on
+// nonempty. Ties go to the cell linked last, so the search order differs
+// from the row-major find_mrv.
+template <int N>
+struct BucketBoard {
+    SudokuBoard<N> board;
+    mask_t<N> cand[N * N];      // candidates of an empty cell, 0 once filled
+    mask_t<N> held[N * N];      // a filled cell's candidates before assign
+    uint8_t count[N * N];       // bucket of each empty cell
+    int16_t next[N * N];
+    int16_t prev[N * N];
+    int16_t head[N + 1];        // -1: empty bucket
+    uint64_t nonempty;
+    int16_t placed[N * N];      // filled cells in order, undone in reverse
+    int removed_mark[N * N];    // removed_count before each of them
+    int placed_count;
+    // Peers that lost a candidate. Each (cell, value) pair goes at most once,
+    // hence N^3, too big for the stack at N = 36. The buffer is per thread
+    // and reused by every search on it, so one BucketBoard per thread at a time
+    int16_t* removed;
+    int removed_count;
+
+    void init(const SudokuBoard<N>& b) {
+        static thread_local int16_t removed_buffer[N * N * N];
+        board = b;
+        removed = removed_buffer;
+        nonempty = 0;
+        placed_count = 0;
+        removed_count = 0;
+        for (int k = 0; k <= N; k++) head[k] = -1;
+        for (int cell = 0; cell < N * N; cell++) {
+            int r = cell / N, c = cell % N;
+            cand[cell] = board.grid[r][c] ? 0 : get_candidates(board, r, c);
+            if (!board.grid[r][c]) link(cell, mask_popcount(cand[cell]));
+        }
+    }
+
+    // Fill an empty cell and move the peers that lose val down one bucket
+    void assign(int cell, int val) {
+        mask_t<N> bit = digit_bit<N>(val);
+        unlink(cell);
+        held[cell] = cand[cell];
+        cand[cell] = 0;
+        removed_mark[placed_count] = removed_count;
+        placed[placed_count++] = (int16_t)cell;
+        for (int p : peers<N>.cells[cell]) {
+            if (cand[p] & bit) {
+                cand[p] ^= bit;
+                removed[removed_count++] = (int16_t)p;
+                relink(p, count[p] - 1);
+            }
+        }
+        place(board, cell / N, cell % N, val);
+    }
+
+    // Undo the assignments made after mark, the exact inverse of assign
+    void undo_to(int mark) {
+        while (placed_count > mark) {
+            int cell = placed[--placed_count];
+            mask_t<N> bit = digit_bit<N>(board.grid[cell / N][cell % N]);
+            unplace(board, cell / N, cell % N);
+            while (removed_count > removed_mark[placed_count]) {
+                int p = removed[--removed_count];
+                cand[p] |= bit;
+                relink(p, count[p] + 1);
+            }
+            cand[cell] = held[cell];
+            link(cell, count[cell]);
+        }
+    }
+
+private:
+    void link(int cell, int k) {
+        count[cell] = (uint8_t)k;
+        prev[cell] = -1;
+        next[cell] = head[k];
+        if (head[k] >= 0) prev[head[k]] = (int16_t)cell;
+        head[k] = (int16_t)cell;
+        nonempty |= 1ULL << k;
+    }
+
+    void unlink(int cell) {
+        int k = count[cell];
+        if (prev[cell] >= 0) next[prev[cell]] = next[cell];
+        else head[k] = next[cell];
+        if (next[cell] >= 0) prev[next[cell]] = prev[cell];
+        if (head[k] < 0) nonempty &= ~(1ULL << k);
+    }
+
+    void relink(int cell, int k) {
+        unlink(cell);
+        link(cell, k);
+    }
+};
+
+// Serial search over a BucketBoard: naked singles straight from bucket 1,
+// then branch on the MRV cell. Assignments are undone on failure.
+template <int N>
+inline bool solve_buckets(BucketBoard<N>& bb, const CancelToken* cancel) {
+    if (cancel && cancel->cancelled()) return false;
+    PropStats& stats = thread_prop_stats();
+    stats.nodes++;
+    int mark = bb.placed_count;
+
+    // Until no single is left or some cell has run out of candidates
+    while ((bb.nonempty & 3) == 2) {
+        int cell = bb.head[1];
+        bb.assign(cell, mask_ctz(bb.cand[cell]) + 1);
+        stats.fired[RULE_NAKED_SINGLE]++;
+    }
+    if (bb.nonempty & 1) {
+        bb.undo_to(mark);
+        return false;
+    }
+    if (bb.nonempty == 0) return true;
+
+    int cell = bb.head[mask_ctz(bb.nonempty)];
+    int values[N];
+    int count = order_values(bb.board, cell / N, cell % N, bb.cand[cell], value_order, values);
+    for (int k = 0; k < count; k++) {
+        int branch = bb.placed_count;
+        bb.assign(cell, values[k]);
+        if (solve_buckets(bb, cancel)) return true;
+        bb.undo_to(branch);
+    }
+
+    bb.undo_to(mark);
     return false;
 }
 
+// Serial solve function (backtracking with MRV). On failure the board is
+// rolled back to how it was on entry. A fired cancel token ends the search
+// as a failure, so a parallel caller can abandon its subtree.
+template <int N>
+inline bool solve_serial(SudokuBoard<N>& b, Trail<N>& trail, const CancelToken* cancel = nullptr) {
+    if (cancel && cancel->cancelled()) return false;
+    int mark = trail.size;
+
+    int best_r = -1, best_c = -1;
+    mask_t<N> best_mask = 0;
+    if (!propagate_and_pick(b, &trail, best_r, best_c, best_mask)) {
+        undo_to(b, trail, mark);
+        return false;
+    }
+
+    if (best_r == -1) return true;
+
+    int values[N];
+    int count = order_values(b, best_r, best_c, best_mask, value_order, values);
+    for (int k = 0; k < count; k++) {
+        place(b, best_r, best_c, values[k]);
+        if (solve_serial(b, trail, cancel)) return true;
+        unplace(b, best_r, best_c);
+    }
+
+    undo_to(b, trail, mark);
+    return false;
+}
+
+// Entry point: the bucket search at prop_level 0, where naked singles are
+// the only rule; the higher levels need the candidate grid of propagate()
+template <int N>
+inline bool solve_serial(SudokuBoard<N>& b, const CancelToken* cancel = nullptr) {
+    if (active_prop_level() == 0) {
+        BucketBoard<N> bb;
+        bb.init(b);
+        if (!solve_buckets(bb, cancel)) return false;
+        b = bb.board;
+        return true;
+    }
+    Trail<N> trail;
+    return solve_serial(b, trail, cancel);
+}
+
+// Grid-level entry point: build the masks, solve, and copy the solution back
+template <int N>
+inline bool solve_grid_serial(int grid[N][N]) {
+    SudokuBoard<N> b;
+    if (!init_board(b, grid)) return false;
+    if (!solve_serial(b)) return false;
+    board_to_grid(b, grid);
+    return true;
+}
+
 #endif
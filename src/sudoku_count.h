@@ -0,0 +1,207 @@
+#ifndef SUDOKU_COUNT_H
+#define SUDOKU_COUNT_H
+
+#include <climits>
+#include "sudoku_common.h"
+#include "sudoku_batch.h"
+#include "sudoku_cutoff.h"
+
+// --- Solution counting (--count K, --unique) ---
+// Instead of stopping at the first solution, the search walks the whole
+// tree and counts solutions, stopping early once K have been found. The
+// serial engines count in one thread; the OpenMP engines split the tree
+// with the same adaptive task cutoff as the solving task tree.
+//
+// Each thread counts into its own padded slot. The slots are summed once the
+// search is over; in between, threads add their count to a shared total in
+// small batches so that reaching K can cancel the others.
+
+template <int N>
+class SolutionCounter {
+public:
+    // limit <= 0 counts every solution; keep is how many to remember
+    SolutionCounter(long long limit, int keep)
+        : limit(limit > 0 ? limit : LLONG_MAX), keep(keep), slots(omp_get_max_threads()) {
+        // Small limits publish every solution, so e.g. --unique stops at the
+        // second one; unlimited counts publish rarely.
+        long long per_thread = this->limit / (4LL * (long long)slots.size());
+        flush_every = (int)max(1LL, min(1024LL, per_thread));
+    }
+
+    CancelToken stop;               // fires once the limit is reached
+    vector<SudokuBoard<N>> first;   // the first `keep` solutions found
+
+    void add(const SudokuBoard<N>& b) {
+        Slot& s = slots[omp_get_thread_num()];
+        s.count++;
+        if (++s.unflushed >= flush_every) flush(s);
+        if ((int)stored.load(memory_order_relaxed) < keep) {
+            lock_guard<mutex> guard(first_lock);
+            if ((int)first.size() < keep) first.push_back(b);
+            stored = (int)first.size();
+        }
+    }
+
+    // Sum of the per-thread counts, capped at the limit. Only valid once
+    // every thread is done.
+    long long count() const {
+        long long total = 0;
+        for (const Slot& s : slots) total += s.count;
+        return min(total, limit);
+    }
+
+private:
+    struct alignas(64) Slot {
+        long long count = 0;
+        int unflushed = 0;
+    };
+
+    long long limit;
+    int keep;
+    int flush_every;
+    vector<Slot> slots;
+    atomic<long long> published{0};
+    atomic<int> stored{0};
+    mutex first_lock;
+
+    void flush(Slot& s) {
+        if (published.fetch_add(s.unflushed) + s.unflushed >= limit) stop.cancel();
+        s.unflushed = 0;
+    }
+};
+
+// Depth-first count below b; the board is rolled back on return
+template <int N, class Pick>
+inline void count_serial(SudokuBoard<N>& b, Trail<N>& trail, Pick pick, SolutionCounter<N>& counter) {
+    if (counter.stop.cancelled()) return;
+    int mark = trail.size;
+
+    int best_r = -1, best_c = -1;
+    mask_t<N> best_mask = 0;
+    if (pick(b, &trail, best_r, best_c, best_mask)) {
+        if (best_r == -1) {
+            counter.add(b);
+        } else {
+            for (int val = 1; val <= N && !counter.stop.cancelled(); val++) {
+                if (best_mask & digit_bit<N>(val)) {
+                    place(b, best_r, best_c, val);
+                    count_serial(b, trail, pick, counter);
+                    unplace(b, best_r, best_c);
+                }
+            }
+        }
+    }
+    undo_to(b, trail, mark);
+}
+
+// Task-parallel count: split while the cost model says the subtree is big
+// enough, count serially below that
+template <int N, class Pick>
+inline void count_tasks(SudokuBoard<N> b, Pick pick, SolutionCounter<N>& counter) {
+    if (counter.stop.cancelled()) return;
+
+    double space = log2_space(b);
+    if (!should_split(space)) {
+        timed_serial(space, [&] {
+            Trail<N> trail;
+            count_serial(b, trail, pick, counter);
+            return true;
+        });
+        return;
+    }
+
+    int best_r = -1, best_c = -1;
+    mask_t<N> best_mask = 0;
+    if (!pick(b, nullptr, best_r, best_c, best_mask)) return;
+    if (best_r == -1) {
+        counter.add(b);
+        return;
+    }
+
+    for (int val = 1; val <= N; val++) {
+        if (!(best_mask & digit_bit<N>(val))) continue;
+        if (counter.stop.cancelled()) break;
+        live_tasks++;
+        #pragma omp task firstprivate(b) shared(counter)
+        {
+            place(b, best_r, best_c, val);
+            count_tasks(b, pick, counter);
+            live_tasks--;
+        }
+    }
+    #pragma omp taskwait
+}
+
+// Count the solutions of one puzzle, up to counter's limit
+template <int N, class Pick>
+inline long long count_solutions(int grid[N][N], Pick pick, bool parallel, SolutionCounter<N>& counter) {
+    SudokuBoard<N> b;
+    if (!init_board(b, grid)) return 0;
+    if (parallel) {
+        live_tasks = 0;
+        #pragma omp parallel
+        {
+            #pragma omp single
+            count_tasks(b, pick, counter);
+        }
+    } else {
+        Trail<N> trail;
+        count_serial(b, trail, pick, counter);
+    }
+    return counter.count();
+}
+
+inline bool counting_requested(int argc, char* argv[]) {
+    return option_value(argc, argv, "--count") != nullptr || has_flag(argc, argv, "--unique");
+}
+
+// Counting driver for the mains. Reads any number of puzzles from stdin and
+// prints one line per puzzle:
+//     "<time> ms count <c>"              (--count K, K <= 0 for no limit)
+//     "<time> ms count <c> <verdict>"    (--unique, verdict none|unique|multiple)
+// followed, with --solutions, by "solution <N*N values>" for the first two
+// solutions found.
+template <int N, class Pick>
+inline int run_count(int argc, char* argv[], Pick pick, bool parallel) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    bool unique = has_flag(argc, argv, "--unique");
+    long long limit = unique ? 2 : atoll(option_value(argc, argv, "--count"));
+    int keep = has_flag(argc, argv, "--solutions") ? 2 : 0;
+
+    int grid[N][N];
+    long long total = 0, solved = 0;
+    double solve_ms = 0.0;
+
+    auto batch_start = chrono::high_resolution_clock::now();
+    while (read_grid(cin, grid)) {
+        SolutionCounter<N> counter(limit, keep);
+        auto start = chrono::high_resolution_clock::now();
+        long long count = count_solutions(grid, pick, parallel, counter);
+        auto end = chrono::high_resolution_clock::now();
+        chrono::duration<double, std::milli> elapsed = end - start;
+        solve_ms += elapsed.count();
+        total++;
+        if (count > 0) solved++;
+
+        cout << elapsed.count() << " ms count " << count;
+        if (unique) cout << (count == 0 ? " none" : count == 1 ? " unique" : " multiple");
+        cout << '\n';
+        for (const SudokuBoard<N>& b : counter.first) {
+            cout << "solution";
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < N; j++) cout << ' ' << (int)b.grid[i][j];
+            }
+            cout << '\n';
+        }
+    }
+    cout.flush();
+    auto batch_end = chrono::high_resolution_clock::now();
+    chrono::duration<double, std::milli> wall = batch_end - batch_start;
+
+    print_summary(total, solved, solve_ms, wall.count());
+    return 0;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SUDOKU_CUTOFF_H
+#define SUDOKU_CUTOFF_H
+
+#include <omp.h>
+#include <atomic>
+#include <cmath>
+#include "sudoku_common.h"
+#include "sudoku_batch.h"
+
+// --- Adaptive cutoff for the OpenMP task tree (--sched tasks) ---
+// Whether a node spawns tasks or finishes its subtree serially is decided
+// per node from a cost estimate, instead of a fixed depth:
+//
+//   space     = log2 of the product of the empty cells' candidate counts
+//   nodes     ~ 2^(alpha * space)
+//   time (us) ~ nodes * us_per_node
+//
+// alpha and us_per_node are learned by each thread from the serial subtrees
+// it has finished, so the estimate follows the puzzle and the machine. A node
+// is split when its predicted time is at least split_min_us and fewer than
+// split_max_tasks tasks per thread are alive; otherwise it goes serial.
+
+struct CutoffParams {
+    double min_us = 200.0;  // --split-min-us: smallest subtree worth a task
+    int max_tasks = 4;      // --split-max-tasks: live tasks per thread
+};
+
+inline CutoffParams cutoff;
+
+inline void parse_cutoff_options(int argc, char* argv[]) {
+    if (const char* value = option_value(argc, argv, "--split-min-us")) cutoff.min_us = atof(value);
+    cutoff.max_tasks = int_option(argc, argv, "--split-max-tasks", cutoff.max_tasks);
+}
+
+// Per-thread model. The starting guesses only matter until the first
+// serial subtree has been timed.
+struct CutoffModel {
+    double alpha = 0.5;       // log2(nodes) per log2(search space)
+    double us_per_node = 1.0;
+
+    double predict_us(double space) const {
+        return exp2(alpha * space) * us_per_node;
+    }
+
+    // Moving averages, weight 1/8 for the newest subtree
+    void learn(double space, long long nodes, double us) {
+        if (space >= 1.0) alpha += (log2((double)nodes + 1.0) / space - alpha) / 8;
+        if (nodes > 0) us_per_node += (us / nodes - us_per_node) / 8;
+    }
+};
+
+inline CutoffModel& thread_cutoff_model() {
+    thread_local CutoffModel model;
+    return model;
+}
+
+// Tasks spawned and not yet finished, across the team
+inline atomic<int> live_tasks{0};
+
+template <int N>
+inline double log2_space(const SudokuBoard<N>& b) {
+    double space = 0.0;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            if (b.grid[i][j] != 0) continue;
+            int count = mask_popcount(get_candidates(b, i, j));
+            if (count > 1) space += log2((double)count);
+        }
+    }
+    return space;
+}
+
+inline bool should_split(double space) {
+    if (live_tasks.load(memory_order_relaxed) >= cutoff.max_tasks * omp_get_num_threads()) return false;
+    return thread_cutoff_model().predict_us(space) >= cutoff.min_us;
+}
+
+// Run a serial subtree and feed its size and time back into the model
+template <class Search>
+inline bool timed_serial(double space, Search search) {
+    long long nodes_before = thread_prop_stats().nodes;
+    auto start = chrono::high_resolution_clock::now();
+    bool ok = search();
+    auto end = chrono::high_resolution_clock::now();
+    double us = chrono::duration<double, std::micro>(end - start).count();
+    thread_cutoff_model().learn(space, thread_prop_stats().nodes - nodes_before, us);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include "sudoku_dlx.h"
+#include "sudoku_batch.h"
+
+constexpr int N = BOARD_N;
+
+int main(int argc, char* argv[]) {
+    parse_solver_options(argc, argv);
+    dlx_solver<N>(); // build the arena outside the timed region
+
+    if (has_flag(argc, argv, "--batch")) {
+        return run_batch<N>(solve_grid_dlx<N>);
+    }
+
+    int grid[N][N];
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            if (!(cin >> grid[i][j])) return 0;
+        }
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    if (solve_grid_dlx(grid)) {
+        auto end = chrono::high_resolution_clock::now();
+        chrono::duration<double, std::milli> elapsed = end - start;
+        cout << elapsed.count() << " ms" << endl;
+    } else {
+        cout << "No solution found." << endl;
+    }
+
+    return 0;
+}
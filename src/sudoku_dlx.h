@@ -0,0 +1,176 @@
+#ifndef SUDOKU_DLX_H
+#define SUDOKU_DLX_H
+
+#include "sudoku_common.h"
+
+// --- Dancing Links (Algorithm X) backend ---
+// Sudoku as exact cover: one matrix row per (cell, digit) choice and one
+// column per constraint, 4 * N * N in total:
+//   cell (r, c) filled, digit d in row r, digit d in column c, digit d in box.
+// Search always branches on the column with the fewest remaining rows, over
+// all four constraint types, where the MRV in solve_serial only looks at
+// cells.
+//
+// The matrix for N is built once. A puzzle covers the rows of its givens,
+// searches, and uncovers everything again on the way out, so the arena is
+// reused across puzzles without relinking.
+
+template <int N>
+class DlxSolver {
+public:
+    static const int COLS = 4 * N * N;
+    static const int ROWS = N * N * N;
+
+    DlxSolver() {
+        int total = 1 + COLS + 4 * ROWS;
+        L.resize(total); R.resize(total); U.resize(total); D.resize(total); C.resize(total);
+        size.assign(COLS + 1, 0);
+        solution.reserve(N * N);
+
+        // Root (0) and column headers (1..COLS) in one circular list
+        for (int i = 0; i <= COLS; i++) {
+            L[i] = (i == 0) ? COLS : i - 1;
+            R[i] = (i == COLS) ? 0 : i + 1;
+            U[i] = D[i] = C[i] = i;
+        }
+
+        // Row (r, c, d) owns nodes first_node(row) .. first_node(row) + 3
+        for (int r = 0; r < N; r++) {
+            for (int c = 0; c < N; c++) {
+                for (int d = 0; d < N; d++) {
+                    int row = row_id(r, c, d);
+                    int cols[4] = {
+                        1 + r * N + c,
+                        1 + N * N + r * N + d,
+                        1 + 2 * N * N + c * N + d,
+                        1 + 3 * N * N + box_of<N>(r, c) * N + d
+                    };
+                    for (int k = 0; k < 4; k++) {
+                        int x = first_node(row) + k;
+                        int col = cols[k];
+                        L[x] = first_node(row) + (k + 3) % 4;
+                        R[x] = first_node(row) + (k + 1) % 4;
+                        C[x] = col;
+                        U[x] = U[col];
+                        D[x] = col;
+                        D[U[col]] = x;
+                        U[col] = x;
+                        size[col]++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Solve grid in place. The matrix is back in its pristine state afterwards,
+    // also when the search gives up because cancel fired.
+    bool solve(int grid[N][N], const CancelToken* cancel = nullptr) {
+        SudokuBoard<N> b;
+        if (!init_board(b, grid)) return false; // conflicting givens
+
+        // Select the givens' rows
+        vector<int> given_rows;
+        for (int r = 0; r < N; r++) {
+            for (int c = 0; c < N; c++) {
+                if (grid[r][c] != 0) given_rows.push_back(row_id(r, c, grid[r][c] - 1));
+            }
+        }
+        for (int row : given_rows) select(first_node(row));
+
+        solution.clear();
+        this->cancel = cancel;
+        bool found = search(grid);
+
+        for (int i = (int)given_rows.size() - 1; i >= 0; i--) deselect(first_node(given_rows[i]));
+        return found;
+    }
+
+private:
+    vector<int> L, R, U, D, C; // node links and column of each node
+    vector<int> size;          // rows left in each column
+    vector<int> solution;      // rows chosen by the search, as node indices
+    const CancelToken* cancel = nullptr;
+
+    static int row_id(int r, int c, int d) { return (r * N + c) * N + d; }
+    static int first_node(int row) { return 1 + COLS + 4 * row; }
+
+    void cover(int col) {
+        L[R[col]] = L[col];
+        R[L[col]] = R[col];
+        for (int i = D[col]; i != col; i = D[i]) {
+            for (int j = R[i]; j != i; j = R[j]) {
+                U[D[j]] = U[j];
+                D[U[j]] = D[j];
+                size[C[j]]--;
+            }
+        }
+    }
+
+    void uncover(int col) {
+        for (int i = U[col]; i != col; i = U[i]) {
+            for (int j = L[i]; j != i; j = L[j]) {
+                size[C[j]]++;
+                U[D[j]] = j;
+                D[U[j]] = j;
+            }
+        }
+        L[R[col]] = col;
+        R[L[col]] = col;
+    }
+
+    // Take a whole row into the solution: cover all four of its columns
+    void select(int node) {
+        cover(C[node]);
+        for (int j = R[node]; j != node; j = R[j]) cover(C[j]);
+    }
+
+    void deselect(int node) {
+        for (int j = L[node]; j != node; j = L[j]) uncover(C[j]);
+        uncover(C[node]);
+    }
+
+    bool search(int grid[N][N]) {
+        if (cancel && cancel->cancelled()) return false;
+        thread_prop_stats().nodes++;
+        if (R[0] == 0) {
+            for (int node : solution) {
+                int row = (node - 1 - COLS) / 4;
+                grid[row / (N * N)][(row / N) % N] = row % N + 1;
+            }
+            return true;
+        }
+
+        // Column MRV over every constraint type
+        int best = R[0];
+        for (int col = R[best]; col != 0 && size[best] > 1; col = R[col]) {
+            if (size[col] < size[best]) best = col;
+        }
+        if (size[best] == 0) return false;
+
+        bool found = false;
+        cover(best);
+        for (int i = D[best]; i != best && !found; i = D[i]) {
+            solution.push_back(i);
+            for (int j = R[i]; j != i; j = R[j]) cover(C[j]);
+            found = search(grid);
+            for (int j = L[i]; j != i; j = L[j]) uncover(C[j]);
+            solution.pop_back();
+        }
+        uncover(best);
+        return found;
+    }
+};
+
+// One arena per board size and thread, built on first use
+template <int N>
+inline DlxSolver<N>& dlx_solver() {
+    thread_local DlxSolver<N> solver;
+    return solver;
+}
+
+template <int N>
+inline bool solve_grid_dlx(int grid[N][N]) {
+    return dlx_solver<N>().solve(grid);
+}
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef SUDOKU_LANES_H
+#define SUDOKU_LANES_H
+
+#include <immintrin.h>
+#include "sudoku_simd.h"
+#include "sudoku_batch.h"
+
+// --- Lockstep multi-puzzle SIMD engine (batch mode with --lanes, N <= 16, AVX2) ---
+// sudoku_simd.h vectorizes inside one board. Here each of the 16 u16 lanes of
+// an AVX2 register belongs to a different puzzle, and the boards are stored
+// structure-of-arrays: lanes.cell[k] holds the candidate mask of cell k for
+// all 16 puzzles. A cell is decided when its mask has a single bit.
+//
+// Every step runs propagation on all lanes to a common fixpoint, then one
+// vector MRV pass gives each lane its verdict: contradiction, solved, or the
+// cell to branch on. Branching and backtracking are per lane (each lane has
+// its own stack of saved boards); a lane that finishes is refilled with the
+// next puzzle, so the register stays full until the input runs out.
+//
+// Inference follows prop_level: naked singles always, hidden singles from
+// level 1. Higher levels are not vectorized; main() keeps those on the
+// per-puzzle solver instead of running them here.
+
+#define LANES 16
+
+template <int N>
+struct LaneBoards {
+    alignas(32) uint16_t cell[N * N][LANES];
+};
+
+template <int N>
+TARGET_AVX2 inline __m256i load_cell(const LaneBoards<N>& lanes, int k) {
+    return _mm256_load_si256((const __m256i*)lanes.cell[k]);
+}
+
+template <int N>
+TARGET_AVX2 inline void store_cell(LaneBoards<N>& lanes, int k, __m256i v) {
+    _mm256_store_si256((__m256i*)lanes.cell[k], v);
+}
+
+// All-ones in the lanes whose mask has at most one bit set
+TARGET_AVX2 inline __m256i is_single_epi16(__m256i v) {
+    __m256i v_minus_1 = _mm256_sub_epi16(v, _mm256_set1_epi16(1));
+    return _mm256_cmpeq_epi16(_mm256_and_si256(v, v_minus_1), _mm256_setzero_si256());
+}
+
+// One pass over the 3N units for all lanes. Decided cells are removed from
+// their peers; with hidden singles, a digit that fits only one cell of the
+// unit is placed there. Lanes with two equal decided cells in a unit, or
+// (with hidden singles) a digit with no place left, are marked in dead.
+// Returns a 32-bit byte mask of the lanes that changed.
+template <int N>
+TARGET_AVX2 inline uint32_t propagate_lanes_pass(LaneBoards<N>& lanes, bool hidden, __m256i& dead) {
+    const __m256i full = _mm256_set1_epi16((short)full_mask<N>);
+    const __m256i ones = _mm256_set1_epi16(-1);
+    __m256i changed = _mm256_setzero_si256();
+
+    for (int u = 0; u < 3 * N; u++) {
+        const int* cells = units<N>.cells[u];
+        __m256i once = _mm256_setzero_si256(), twice = _mm256_setzero_si256();
+        __m256i placed = _mm256_setzero_si256(), placed_twice = _mm256_setzero_si256();
+        for (int k = 0; k < N; k++) {
+            __m256i v = load_cell(lanes, cells[k]);
+            __m256i s = _mm256_and_si256(v, is_single_epi16(v));
+            twice = _mm256_or_si256(twice, _mm256_and_si256(once, v));
+            once = _mm256_or_si256(once, v);
+            placed_twice = _mm256_or_si256(placed_twice, _mm256_and_si256(placed, s));
+            placed = _mm256_or_si256(placed, s);
+        }
+        dead = _mm256_or_si256(dead, _mm256_xor_si256(
+            _mm256_cmpeq_epi16(placed_twice, _mm256_setzero_si256()), ones));
+        __m256i unique = _mm256_andnot_si256(twice, once);
+        if (hidden) {
+            dead = _mm256_or_si256(dead, _mm256_xor_si256(_mm256_cmpeq_epi16(once, full), ones));
+        }
+
+        for (int k = 0; k < N; k++) {
+            __m256i v = load_cell(lanes, cells[k]);
+            __m256i single = is_single_epi16(v);
+            __m256i nv = _mm256_blendv_epi8(_mm256_andnot_si256(placed, v), v, single);
+            if (hidden) {
+                __m256i h = _mm256_and_si256(nv, unique);
+                __m256i none = _mm256_cmpeq_epi16(h, _mm256_setzero_si256());
+                nv = _mm256_blendv_epi8(h, nv, none);
+            }
+            changed = _mm256_or_si256(changed, _mm256_xor_si256(nv, v));
+            store_cell(lanes, cells[k], nv);
+        }
+    }
+    return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(changed, _mm256_setzero_si256()));
+}
+
+// MRV over all lanes at once. Each cell gets the key (candidates << 8 | cell),
+// with 0xFFFF for decided cells, and the per-lane minimum is kept, so the
+// lowest key names the branching cell. A key with count 0 means an empty
+// cell (contradiction); 0xFFFF means the board is solved.
+template <int N>
+TARGET_AVX2 inline void mrv_lanes(const LaneBoards<N>& lanes, uint16_t keys[LANES]) {
+    __m256i best = _mm256_set1_epi16(-1);
+    for (int k = 0; k < N * N; k++) {
+        __m256i v = load_cell(lanes, k);
+        __m256i key = _mm256_or_si256(_mm256_slli_epi16(popcount_epi16(v), 8), _mm256_set1_epi16((short)k));
+        __m256i decided = _mm256_andnot_si256(_mm256_cmpeq_epi16(v, _mm256_setzero_si256()), is_single_epi16(v));
+        key = _mm256_or_si256(key, decided);
+        best = _mm256_min_epu16(best, key);
+    }
+    _mm256_storeu_si256((__m256i*)keys, best);
+}
+
+// Lockstep solver over one chunk of puzzles. Solutions are written back into
+// the items' grids; elapsed_ms is the time from loading a puzzle into a lane
+// to its verdict, so it includes the steps shared with the other lanes.
+template <int N>
+class LaneEngine {
+    static_assert(N <= 16, "lanes hold 16-bit masks");
+
+public:
+    struct Item {
+        int grid[N][N];
+        double elapsed_ms;
+        bool ok;
+    };
+
+    LaneEngine() : stack(LANES * N * N * N * N) {}
+
+    TARGET_AVX2 void solve_chunk(Item* items, int count) {
+        const bool hidden = active_prop_level() >= 1;
+        PropStats& stats = thread_prop_stats();
+        next = 0;
+        int busy = 0;
+        for (int l = 0; l < LANES; l++) {
+            slot[l] = -1;
+            if (refill(items, count, l)) busy++;
+        }
+
+        while (busy > 0) {
+            __m256i dead = _mm256_setzero_si256();
+            while (propagate_lanes_pass(lanes, hidden, dead)) {}
+            uint16_t keys[LANES], dead_lanes[LANES];
+            mrv_lanes(lanes, keys);
+            _mm256_storeu_si256((__m256i*)dead_lanes, dead);
+
+            for (int l = 0; l < LANES; l++) {
+                if (slot[l] < 0) continue;
+                stats.nodes++;
+                uint16_t key = keys[l];
+                if (dead_lanes[l] || (key >> 8) == 0) {
+                    if (depth[l] > 0) {
+                        pop(l);
+                        continue;
+                    }
+                    finish(items, l, false);
+                } else if (key == 0xFFFF) {
+                    finish(items, l, true);
+                } else {
+                    int k = key & 0xFF;
+                    uint16_t v = lanes.cell[k][l];
+                    uint16_t bit = v & (uint16_t)-v;
+                    lanes.cell[k][l] = v & ~bit;
+                    push(l);
+                    lanes.cell[k][l] = bit;
+                    continue;
+                }
+                if (!refill(items, count, l)) busy--;
+            }
+        }
+    }
+
+private:
+    LaneBoards<N> lanes;
+    vector<uint16_t> stack;  // per lane, up to N * N saved boards
+    int depth[LANES];
+    int slot[LANES];         // item solved in each lane, -1 when idle
+    chrono::high_resolution_clock::time_point started[LANES];
+    int next;
+
+    uint16_t* saved(int l, int d) { return &stack[((size_t)l * N * N + d) * N * N]; }
+
+    void push(int l) {
+        uint16_t* out = saved(l, depth[l]++);
+        for (int k = 0; k < N * N; k++) out[k] = lanes.cell[k][l];
+    }
+
+    void pop(int l) {
+        const uint16_t* in = saved(l, --depth[l]);
+        for (int k = 0; k < N * N; k++) lanes.cell[k][l] = in[k];
+    }
+
+    // Load the next puzzle into lane l, or park the lane (all cells 0) when
+    // the chunk is used up. Conflicting givens are reported straight away.
+    bool refill(Item* items, int count, int l) {
+        while (next < count) {
+            Item& item = items[next];
+            started[l] = chrono::high_resolution_clock::now();
+            SudokuBoard<N> b;
+            if (!init_board(b, item.grid)) {
+                item.ok = false;
+                item.elapsed_ms = 0.0;
+                next++;
+                continue;
+            }
+            for (int k = 0; k < N * N; k++) {
+                int val = item.grid[k / N][k % N];
+                lanes.cell[k][l] = val ? (uint16_t)(1u << (val - 1)) : (uint16_t)full_mask<N>;
+            }
+            slot[l] = next++;
+            depth[l] = 0;
+            return true;
+        }
+        for (int k = 0; k < N * N; k++) lanes.cell[k][l] = 0;
+        slot[l] = -1;
+        return false;
+    }
+
+    void finish(Item* items, int l, bool ok) {
+        Item& item = items[slot[l]];
+        auto end = chrono::high_resolution_clock::now();
+        item.elapsed_ms = chrono::duration<double, std::milli>(end - started[l]).count();
+        item.ok = ok;
+        if (ok) {
+            for (int k = 0; k < N * N; k++) {
+                item.grid[k / N][k % N] = __builtin_ctz(lanes.cell[k][l]) + 1;
+            }
+        }
+        slot[l] = -1;
+    }
+};
+
+// Batch driver: same input/output contract as run_batch. Puzzles are read in
+// chunks of BATCH_CHUNK and printed in input order.
+template <int N>
+inline int run_batch_lanes() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    vector<typename LaneEngine<N>::Item> items(BATCH_CHUNK);
+    LaneEngine<N> engine;
+    long long total = 0, solved = 0;
+    double solve_ms = 0.0;
+
+    auto batch_start = chrono::high_resolution_clock::now();
+    bool more = true;
+    while (more) {
+        int count = 0;
+        while (count < BATCH_CHUNK && (more = read_grid(cin, items[count].grid))) count++;
+        if (count == 0) break;
+
+        auto start = chrono::high_resolution_clock::now();
+        engine.solve_chunk(items.data(), count);
+        auto end = chrono::high_resolution_clock::now();
+        solve_ms += chrono::duration<double, std::milli>(end - start).count();
+
+        for (int i = 0; i < count; i++) {
+            if (items[i].ok) {
+                solved++;
+                print_result(cout, items[i].grid, items[i].elapsed_ms);
+            } else {
+                cout << "No solution found.\n";
+            }
+        }
+        total += count;
+    }
+    cout.flush();
+    auto batch_end = chrono::high_resolution_clock::now();
+    chrono::duration<double, std::milli> wall = batch_end - batch_start;
+
+    print_summary(total, solved, solve_ms, wall.count());
+    return 0;
+}
+
+#endif
@@ -1,146 +1,189 @@
 #include <omp.h>
 #include "sudoku_common.h"
-
-#ifndef CUTOFF_DEPTH
-#define CUTOFF_DEPTH 2
-#endif
-
-// Global flag to stop other threads when solution is found
-bool global_solved = false;
+#include "sudoku_batch.h"
+#include "sudoku_count.h"
+#include "sudoku_ws.h"
+#include "sudoku_portfolio.h"
+#include "sudoku_cutoff.h"
+#include "sudoku_server.h"
+#include "sudoku_affinity.h"
+
+constexpr int N = BOARD_N;
+
+// Fired by the first task that finds a solution; every other task and
+// serial subtree polls it and gives up
+CancelToken cancel_token;
+
+// Single-puzzle scheduler: the adaptive task tree (default), the
+// work-stealing search of sudoku_ws.h, or the racing configurations of
+// sudoku_portfolio.h
+enum Scheduler { SCHED_TASKS, SCHED_WS, SCHED_PORTFOLIO };
+Scheduler sched = SCHED_TASKS;
 
 struct SudokuState {
-    int grid[N][N];
+    SudokuBoard<N> board;
 };
 
-// Helper to copy grid to state
-SudokuState make_state(int grid[N][N]) {
-    SudokuState s;
-    memcpy(s.grid, grid, sizeof(s.grid));
-    return s;
+// Solved grid, written once by whichever task finishes first
+SudokuState solution;
+
+void publish_solution(const SudokuState& state) {
+    if (cancel_token.cancel()) solution = state;
 }
 
-bool solve_omp(SudokuState state, int depth) {
-    if (global_solved) return true; // Early exit
+// Helper to build a state (grid + masks) from a grid; false on conflicting givens
+bool make_state(SudokuState& s, int grid[N][N]) {
+    return init_board(s.board, grid);
+}
+
+bool solve_omp(SudokuState state) {
+    if (cancel_token.cancelled()) return false; // Early exit
 
-    // Cutoff to serial for deeper levels to avoid excessive task creation overhead
-    if (depth > CUTOFF_DEPTH) { 
-        if (solve_serial(state.grid)) {
-            #pragma omp atomic write
-            global_solved = true;
+    // Go serial when the estimated subtree is too small to pay for tasks
+    double space = log2_space(state.board);
+    if (!should_split(space)) {
+        if (timed_serial(space, [&] { return solve_serial(state.board, &cancel_token); })) {
+            publish_solution(state);
             return true;
         }
         return false;
     }
 
-    // We work on the local copy 'state' directly
-    SudokuState backup = state; // Struct copy is clean
-
-    if (!propagate(state.grid)) {
-        return false;
-    }
-
-    int min_candidates = N + 1;
     int best_r = -1, best_c = -1;
-    int best_mask = 0;
-
-    bool solved = true;
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            if (state.grid[i][j] == 0) {
-                solved = false;
-                int mask = get_candidates(state.grid, i, j);
-                if (mask == 0) {
-                    return false;
-                }
-                
-                int count = 0;
-                int temp = mask;
-                while (temp) { temp &= (temp - 1); count++; }
-
-                if (count < min_candidates) {
-                    min_candidates = count;
-                    best_r = i;
-                    best_c = j;
-                    best_mask = mask;
-                }
-            }
-        }
+    mask_t<N> best_mask = 0;
+    if (!propagate_and_pick(state.board, nullptr, best_r, best_c, best_mask)) {
+        return false;
     }
 
-    if (solved) {
-        #pragma omp atomic write
-        global_solved = true;
+    if (best_r == -1) {
+        publish_solution(state);
         return true;
     }
 
-    // Parallelize the branching
-    bool found = false;
-    
-    // Collect all valid moves
-    vector<int> moves;
-    for (int val = 1; val <= N; val++) {
-        if (best_mask & (1 << (val - 1))) {
-            moves.push_back(val);
-        }
-    }
+    // Valid moves in --value-order, the most promising first
+    int values[N];
+    int count = order_values(state.board, best_r, best_c, best_mask, value_order, values);
 
     // If only 1 move, no need to spawn task
-    if (moves.size() == 1) {
-        state.grid[best_r][best_c] = moves[0];
-        if (solve_omp(state, depth + 1)) return true;
-    } else {
-        #pragma omp taskgroup
-        {
-            for (int val : moves) {
-                if (global_solved) break;
-                
-                // Use firstprivate(state) to automatically copy the struct
-                #pragma omp task firstprivate(state) shared(global_solved, found) priority(1)
-                {
-                    if (!global_solved) {
-                        state.grid[best_r][best_c] = val;
-                        if (solve_omp(state, depth + 1)) {
-                            #pragma omp atomic write
-                            global_solved = true;
-                            
-                            #pragma omp critical
-                            {
-                                found = true;
-                            }
-                        }
-                    }
+    if (count == 1) {
+        place(state.board, best_r, best_c, values[0]);
+        return solve_omp(state);
+    }
+
+    #pragma omp taskgroup
+    {
+        for (int k = 1; k < count; k++) {
+            if (cancel_token.cancelled()) break;
+            int val = values[k];
+
+            // Use firstprivate(state) to automatically copy the struct
+            live_tasks++;
+            #pragma omp task firstprivate(state) priority(1)
+            {
+                // With OMP_CANCELLATION=true, siblings that have not started
+                // yet are dropped here once the group is cancelled
+                #pragma omp cancellation point taskgroup
+                place(state.board, best_r, best_c, val);
+                solve_omp(state);
+                live_tasks--;
+                if (cancel_token.cancelled()) {
+                    #pragma omp cancel taskgroup
                 }
             }
         }
+
+        // The first move runs here, right away, while idle threads pick up
+        // the siblings queued above
+        if (!cancel_token.cancelled()) {
+            SudokuState child = state;
+            place(child.board, best_r, best_c, values[0]);
+            solve_omp(child);
+        }
     }
-    
-    if (global_solved) return true; // Someone found it
 
-    return false;
+    return cancel_token.cancelled(); // Someone found it
 }
 
-int main() {
-    int grid[N][N];
-    for (int i = 0; i < N; ++i) {
-        for (int j = 0; j < N; ++j) {
-            if (!(cin >> grid[i][j])) return 0;
-        }
-    }
+// Solve one puzzle with the task-parallel search; the solution is copied
+// back into grid.
+bool solve_parallel(int grid[N][N]) {
+    if (sched == SCHED_WS) return solve_grid_ws(grid, propagate_and_pick<N>);
+    if (sched == SCHED_PORTFOLIO) return solve_grid_portfolio(grid, propagate_and_pick<N>);
 
-    auto start = chrono::high_resolution_clock::now();
-    
-    bool result = false;
-    SudokuState initial_state = make_state(grid);
+    cancel_token.reset();
+    live_tasks = 0; // tasks dropped by a cancelled group never count down
+    SudokuState initial_state;
+    if (!make_state(initial_state, grid)) return false;
 
     #pragma omp parallel
     {
         #pragma omp single
         {
-            result = solve_omp(initial_state, 0);
+            solve_omp(initial_state);
         }
     }
 
-    if (global_solved) { // Use the flag as the truth
+    record_quiescence(cancel_token);
+    if (!cancel_token.cancelled()) return false;
+    board_to_grid(solution.board, grid);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    parse_solver_options(argc, argv);
+    parse_cutoff_options(argc, argv);
+    if (has_flag(argc, argv, "--stats") && !omp_get_cancellation()) {
+        cerr << "omp cancellation: off (set OMP_CANCELLATION=true to drop queued tasks)" << endl;
+    }
+
+    // --sched tasks|ws|portfolio: how a single puzzle is split (tasks by default)
+    if (const char* name = option_value(argc, argv, "--sched")) {
+        if (strcmp(name, "ws") == 0) sched = SCHED_WS;
+        else if (strcmp(name, "portfolio") == 0) sched = SCHED_PORTFOLIO;
+        else if (strcmp(name, "tasks") != 0) cerr << "Unknown scheduler " << name << ", using tasks." << endl;
+    }
+    if (sched == SCHED_PORTFOLIO && has_flag(argc, argv, "--stats")) {
+        atexit([] { print_portfolio_stats(cerr); });
+    }
+
+    // --pin compact|scatter|cores: pin the team before the first solve and
+    // let each thread allocate its counters and cutoff model while pinned.
+    // The effective placement goes to stderr (with --stats even unpinned).
+    PinPolicy pin = PIN_NONE;
+    if (const char* name = option_value(argc, argv, "--pin")) {
+        if (!parse_pin_policy(name, pin)) cerr << "Unknown pin policy " << name << ", not pinning." << endl;
+    }
+    if (pin != PIN_NONE || has_flag(argc, argv, "--stats")) {
+        pin_omp_team(pin, [] { thread_prop_stats(); thread_cutoff_model(); }, cerr);
+    }
+
+    // --count K / --unique: count solutions, the tree split into tasks
+    if (counting_requested(argc, argv)) return run_count<N>(argc, argv, propagate_and_pick<N>, true);
+
+    // --serve PATH: stay resident and answer puzzles on a Unix socket
+    // ("-" for stdin/stdout), with the team kept warm between requests
+    if (const char* path = option_value(argc, argv, "--serve")) {
+        return run_server<N>(path, solve_parallel);
+    }
+
+    // --batch: whole puzzles in parallel, one serial search per thread.
+    // --batch-intra: puzzles one at a time, each split into tasks.
+    if (has_flag(argc, argv, "--batch")) {
+        return run_batch_parallel<N>(solve_grid_serial<N>);
+    }
+    if (has_flag(argc, argv, "--batch-intra")) {
+        return run_batch<N>(solve_parallel);
+    }
+
+    int grid[N][N];
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            if (!(cin >> grid[i][j])) return 0;
+        }
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    if (solve_parallel(grid)) {
         auto end = chrono::high_resolution_clock::now();
         chrono::duration<double, std::milli> elapsed = end - start;
         cout << elapsed.count() << " ms" << endl;
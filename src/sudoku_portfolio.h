@@ -0,0 +1,191 @@
+#ifndef SUDOKU_PORTFOLIO_H
+#define SUDOKU_PORTFOLIO_H
+
+#include <omp.h>
+#include "sudoku_common.h"
+#include "sudoku_dlx.h"
+
+// --- Portfolio search for one puzzle (--sched portfolio) ---
+// On hard puzzles the node count swings by orders of magnitude with the MRV
+// tie-break and the value order, and no single setting wins everywhere.
+// Instead of splitting one search tree, every OpenMP thread runs a whole
+// serial search with its own configuration; the first to finish publishes
+// its board and cancels the rest. Thread 0 runs the default configuration
+// (the row-major MRV of propagate_and_pick), so the portfolio is never
+// slower than that search by more than the sharing of the machine.
+//
+// Configurations are taken from portfolio_configs in thread order; threads
+// beyond the table run randomized searches with their own seed.
+
+enum TieBreak { TIE_FIRST, TIE_LAST, TIE_RANDOM };
+
+struct PortfolioConfig {
+    const char* name;
+    bool dlx;             // Dancing Links instead of the MRV search
+    TieBreak tie;         // which of the MRV cells with equal counts to branch on
+    ValueOrder order;     // see order_values; VALUES_RANDOM shuffles
+    int prop_level;       // -1: the global --prop-level
+    unsigned seed;        // for TIE_RANDOM / VALUES_RANDOM
+};
+
+static const PortfolioConfig portfolio_configs[] = {
+    {"default",      false, TIE_FIRST,  VALUES_ASCENDING,  -1, 0},
+    {"dlx",          true,  TIE_FIRST,  VALUES_ASCENDING,  -1, 0},
+    {"random",       false, TIE_RANDOM, VALUES_RANDOM,     -1, 1},
+    {"last-desc",    false, TIE_LAST,   VALUES_DESCENDING, -1, 0},
+    {"hidden",       false, TIE_FIRST,  VALUES_ASCENDING,   1, 0},
+    {"hidden-random", false, TIE_RANDOM, VALUES_RANDOM,     1, 2},
+    {"box-line",     false, TIE_FIRST,  VALUES_DESCENDING,  3, 0},
+    {"random-2",     false, TIE_RANDOM, VALUES_RANDOM,     -1, 3},
+    {"lcv",          false, TIE_FIRST,  VALUES_LCV,        -1, 0},
+    {"hidden-freq",  false, TIE_FIRST,  VALUES_FREQUENCY,   1, 0},
+};
+static const int PORTFOLIO_TABLE = sizeof(portfolio_configs) / sizeof(portfolio_configs[0]);
+
+inline PortfolioConfig portfolio_config(int thread) {
+    if (thread < PORTFOLIO_TABLE) return portfolio_configs[thread];
+    return PortfolioConfig{"random-n", false, TIE_RANDOM, VALUES_RANDOM, -1, (unsigned)thread + 1};
+}
+
+// Wins per configuration, printed by --stats
+inline atomic<long long> portfolio_wins[PORTFOLIO_TABLE + 1];
+
+inline void print_portfolio_stats(ostream& out) {
+    out << "portfolio wins:";
+    for (int i = 0; i <= PORTFOLIO_TABLE; i++) {
+        out << " " << (i < PORTFOLIO_TABLE ? portfolio_configs[i].name : "random-n") << "=" << portfolio_wins[i].load();
+    }
+    out << endl;
+}
+
+// One serial search with a configuration. Pick is the engine's
+// propagate_and_pick, used as is for the first-cell tie-break; the other
+// tie-breaks need the whole candidate grid and go through propagate().
+template <int N, class Pick>
+class ConfiguredSearch {
+public:
+    ConfiguredSearch(const PortfolioConfig& config, Pick pick, const CancelToken* cancel)
+        : config(config), pick_first(pick), cancel(cancel), rng(0x9E3779B97F4A7C15ULL * (config.seed + 1)) {}
+
+    bool solve(SudokuBoard<N>& b, Trail<N>& trail) {
+        if (cancel->cancelled()) return false;
+        int mark = trail.size;
+
+        int best_r = -1, best_c = -1;
+        mask_t<N> best_mask = 0;
+        if (!pick(b, &trail, best_r, best_c, best_mask)) {
+            undo_to(b, trail, mark);
+            return false;
+        }
+        if (best_r == -1) return true;
+
+        int values[N];
+        int count = order_values(b, best_r, best_c, best_mask, config.order, values);
+        if (config.order == VALUES_RANDOM) {
+            for (int i = count - 1; i > 0; i--) swap(values[i], values[next_random() % (i + 1)]);
+        }
+
+        for (int k = 0; k < count; k++) {
+            place(b, best_r, best_c, values[k]);
+            if (solve(b, trail)) return true;
+            unplace(b, best_r, best_c);
+        }
+
+        undo_to(b, trail, mark);
+        return false;
+    }
+
+private:
+    const PortfolioConfig& config;
+    Pick pick_first;
+    const CancelToken* cancel;
+    uint64_t rng;
+
+    uint64_t next_random() {
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        return rng * 0x2545F4914F6CDD1DULL;
+    }
+
+    bool pick(SudokuBoard<N>& b, trail_ptr<N> trail, int& best_r, int& best_c, mask_t<N>& best_mask) {
+        if (config.tie == TIE_FIRST) return pick_first(b, trail, best_r, best_c, best_mask);
+
+        thread_prop_stats().nodes++;
+        mask_t<N> cand[N][N];
+        if (!propagate(b, trail, cand)) return false;
+
+        int min_candidates = N + 1, ties = 0;
+        best_r = -1;
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                if (b.grid[i][j] != 0) continue;
+                if (cand[i][j] == 0) return false;
+                int count = mask_popcount(cand[i][j]);
+                if (count < min_candidates) {
+                    min_candidates = count;
+                    ties = 0;
+                }
+                if (count != min_candidates) continue;
+                // TIE_LAST keeps the last cell seen; TIE_RANDOM keeps each
+                // of the k tied cells with probability 1/k
+                ties++;
+                if (config.tie == TIE_LAST || next_random() % ties == 0) {
+                    best_r = i;
+                    best_c = j;
+                    best_mask = cand[i][j];
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Race the configurations on the OpenMP team; the solution is copied back
+// into grid
+template <int N, class Pick>
+inline bool solve_grid_portfolio(int grid[N][N], Pick pick) {
+    SudokuBoard<N> start;
+    if (!init_board(start, grid)) return false;
+
+    CancelToken done;
+    SudokuBoard<N> solution;
+    int winner = -1;
+
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        PortfolioConfig config = portfolio_config(t);
+        bool ok;
+        if (config.dlx) {
+            int local[N][N];
+            memcpy(local, grid, sizeof(local));
+            ok = dlx_solver<N>().solve(local, &done);
+            if (ok && done.cancel()) {
+                init_board(solution, local);
+                winner = t;
+            }
+        } else {
+            thread_prop_level = config.prop_level;
+            SudokuBoard<N> b = start;
+            Trail<N> trail;
+            ConfiguredSearch<N, Pick> search(config, pick, &done);
+            ok = search.solve(b, trail);
+            thread_prop_level = -1;
+            if (ok && done.cancel()) {
+                solution = b;
+                winner = t;
+            }
+        }
+        // An exhausted search proves there is no solution: stop the others
+        if (!ok) done.cancel();
+    }
+
+    record_quiescence(done);
+    if (winner < 0) return false;
+    portfolio_wins[min(winner, PORTFOLIO_TABLE)]++;
+    board_to_grid(solution, grid);
+    return true;
+}
+
+#endif
@@ -1,6 +1,19 @@
 #include "sudoku_common.h"
+#include "sudoku_batch.h"
+#include "sudoku_count.h"
+
+constexpr int N = BOARD_N;
+
+int main(int argc, char* argv[]) {
+    parse_solver_options(argc, argv);
+
+    // --count K / --unique: count solutions instead of solving
+    if (counting_requested(argc, argv)) return run_count<N>(argc, argv, propagate_and_pick<N>, false);
+
+    if (has_flag(argc, argv, "--batch")) {
+        return run_batch<N>(solve_grid_serial<N>);
+    }
 
-int main() {
     int grid[N][N];
     for (int i = 0; i < N; ++i) {
         for (int j = 0; j < N; ++j) {
@@ -9,7 +22,7 @@ int main() {
     }
 
     auto start = chrono::high_resolution_clock::now();
-    if (solve_serial(grid)) {
+    if (solve_grid_serial(grid)) {
         auto end = chrono::high_resolution_clock::now();
         chrono::duration<double, std::milli> elapsed = end - start;
         cout << elapsed.count() << " ms" << endl;
@@ -0,0 +1,144 @@
+#ifndef SUDOKU_SERVER_H
+#define SUDOKU_SERVER_H
+
+#include <omp.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "sudoku_common.h"
+#include "sudoku_batch.h"
+
+// --- Solver daemon (--serve PATH) ---
+// A long-running process that keeps the OpenMP team, the per-thread
+// counters and the learned cutoff model warm between requests, so a request
+// costs the solve and not process and team startup. It listens on a Unix
+// domain socket at PATH, or talks over stdin/stdout when PATH is "-" (for
+// use behind a pipe or a supervisor).
+//
+// Protocol, one line each way:
+//     request:  N * N values of one puzzle, row-major, 0 for empty
+//     response: "<time> ms <N*N solution values>" or "No solution found."
+//               or "Bad request: ..." for a line that is not a puzzle
+// Connections are served one at a time; every request gets the whole team.
+
+// Parse one request line into grid; false (with a reason) on bad input
+template <int N>
+inline bool parse_request(const char* line, int grid[N][N], string& error) {
+    const char* p = line;
+    for (int k = 0; k < N * N; k++) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p) {
+            error = "expected " + to_string(N * N) + " values, got " + to_string(k);
+            return false;
+        }
+        if (v < 0 || v > N) {
+            error = "value " + to_string(v) + " out of range";
+            return false;
+        }
+        grid[k / N][k % N] = (int)v;
+        p = end;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    if (*p != '\0') {
+        error = "more than " + to_string(N * N) + " values";
+        return false;
+    }
+    return true;
+}
+
+// Answer every request on in until EOF, flushing after each response
+template <int N, class Solver>
+inline void serve_stream(FILE* in, FILE* out, Solver solve) {
+    char* line = nullptr;
+    size_t cap = 0;
+    int grid[N][N];
+    string error;
+    while (getline(&line, &cap, in) > 0) {
+        if (strspn(line, " \t\r\n") == strlen(line)) continue;
+        if (!parse_request<N>(line, grid, error)) {
+            fprintf(out, "Bad request: %s\n", error.c_str());
+        } else {
+            auto start = chrono::high_resolution_clock::now();
+            bool ok = solve(grid);
+            auto end = chrono::high_resolution_clock::now();
+            double ms = chrono::duration<double, std::milli>(end - start).count();
+            if (ok) {
+                fprintf(out, "%g ms", ms);
+                for (int k = 0; k < N * N; k++) fprintf(out, " %d", grid[k / N][k % N]);
+                fputc('\n', out);
+            } else {
+                fputs("No solution found.\n", out);
+            }
+        }
+        if (fflush(out) != 0) break; // client went away
+    }
+    free(line);
+}
+
+template <int N, class Solver>
+inline int run_server(const char* path, Solver solve) {
+    signal(SIGPIPE, SIG_IGN);
+
+    // Warm up: start the team and run one full solve, so the thread pool,
+    // thread-local state and lazily built tables exist before the first
+    // request arrives
+    #pragma omp parallel
+    {
+        thread_prop_stats();
+    }
+    int blank[N][N] = {};
+    solve(blank);
+
+    if (strcmp(path, "-") == 0) {
+        serve_stream<N>(stdin, stdout, solve);
+        return 0;
+    }
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        cerr << "Socket path too long: " << path << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return 1;
+    }
+    unlink(path);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 16) < 0) {
+        perror(path);
+        close(listener);
+        return 1;
+    }
+    cerr << "serving " << N << "x" << N << " puzzles on " << path
+         << " with " << omp_get_max_threads() << " threads" << endl;
+
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        FILE* in = fdopen(fd, "r");
+        if (!in) {
+            close(fd);
+            continue;
+        }
+        int out_fd = dup(fd);
+        FILE* out = out_fd < 0 ? nullptr : fdopen(out_fd, "w");
+        if (out) {
+            serve_stream<N>(in, out, solve);
+            fclose(out);
+        } else if (out_fd >= 0) {
+            close(out_fd);
+        }
+        fclose(in);
+    }
+}
+
+#endif
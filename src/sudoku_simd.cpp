@@ -1,10 +1,37 @@
 #include "sudoku_simd.h"
+#include "sudoku_batch.h"
+#include "sudoku_count.h"
+#include "sudoku_lanes.h"
+
+constexpr int N = BOARD_N;
 
 bool solve_simd(int grid[N][N]) {
-    return solve_simd_serial(grid);
+    return solve_simd_grid(grid);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    parse_solver_options(argc, argv);
+    if (has_flag(argc, argv, "--stats")) cerr << "simd isa: " << simd_isa_names[simd_isa] << endl;
+
+    // --count K / --unique: count solutions instead of solving
+    if (counting_requested(argc, argv)) return run_count<N>(argc, argv, propagate_and_pick_simd<N>, false);
+
+    if (has_flag(argc, argv, "--batch")) {
+#if BOARD_N <= 16
+        // --lanes: the lockstep engine of sudoku_lanes.h. Opt-in, since every
+        // lane pays for every propagation pass until all lanes are at their
+        // fixpoint, which loses to the per-puzzle scan on hard puzzles. The
+        // lanes only know naked and hidden singles and always branch on the
+        // lowest candidate; --prop-level 2|3 or any other --value-order goes
+        // through solve_simd_serial
+        if (has_flag(argc, argv, "--lanes") && simd_isa >= ISA_AVX2 && active_prop_level() <= 1 &&
+            value_order == VALUES_ASCENDING) {
+            return run_batch_lanes<N>();
+        }
+#endif
+        return run_batch<N>(solve_simd);
+    }
+
     int grid[N][N];
     for (int i = 0; i < N; ++i) {
         for (int j = 0; j < N; ++j) {
@@ -2,130 +2,688 @@
 #define SUDOKU_SIMD_H
 
 #include <immintrin.h>
+#include <cstdlib>
 #include "sudoku_common.h"
 
 // --- SIMD Helpers Start ---
-inline int h_or(__m256i v) {
-    __m128i vlow = _mm256_castsi256_si128(v);
-    __m128i vhigh = _mm256_extracti128_si256(v, 1);
-    vlow = _mm_or_si128(vlow, vhigh);
-    __m128i vshuf = _mm_shuffle_epi32(vlow, _MM_SHUFFLE(1, 0, 3, 2));
-    vlow = _mm_or_si128(vlow, vshuf);
-    vshuf = _mm_shuffle_epi32(vlow, _MM_SHUFFLE(2, 3, 0, 1));
-    vlow = _mm_or_si128(vlow, vshuf);
-    return _mm_cvtsi128_si32(vlow);
-}
-
-inline int get_candidates_simd(int grid[N][N], int r, int c) {
-    int used = 0;
-    __m256i v_used = _mm256_setzero_si256();
-    __m256i v_ones = _mm256_set1_epi32(1);
-    __m256i v_zero = _mm256_setzero_si256();
-
-    int k = 0;
-    for (; k <= N - 8; k += 8) {
-        __m256i v_vals = _mm256_loadu_si256((__m256i*)&grid[r][k]);
-        __m256i v_mask = _mm256_cmpgt_epi32(v_vals, v_zero);
-        __m256i v_shifts = _mm256_sub_epi32(v_vals, v_ones);
-        __m256i v_bits = _mm256_sllv_epi32(v_ones, v_shifts);
-        v_bits = _mm256_and_si256(v_bits, v_mask);
-        v_used = _mm256_or_si256(v_used, v_bits);
-    }
-    for (; k < N; k++) {
-        if (grid[r][k] != 0) used |= (1 << (grid[r][k] - 1));
-    }
-
-    for (int k = 0; k < N; k++) {
-        if (grid[k][c] != 0) used |= (1 << (grid[k][c] - 1));
-    }
-
-    int br = (r / SQRT_N) * SQRT_N;
-    int bc = (c / SQRT_N) * SQRT_N;
-    for (int i = 0; i < SQRT_N; i++) {
-        for (int j = 0; j < SQRT_N; j++) {
-            int val = grid[br + i][bc + j];
-            if (val != 0) used |= (1 << (val - 1));
+
+// Candidate masks are 16-bit for N <= 16, so one register holds a whole row.
+template <int N> constexpr int row_lanes = (N <= 16 ? 16 : N);
+
+// Whole-board scan: the candidates of every cell, the empty cells with
+// exactly one candidate, and the MRV cell, all from one pass over the board.
+template <int N>
+struct BoardScan {
+    alignas(32) mask_t<N> cand[N][row_lanes<N>]; // filled cells included; check grid
+    uint64_t singles[N];                          // per row, empty cells with one candidate
+    int best_r, best_c;                           // MRV cell, best_r == -1 when the board is full
+    int best_count;
+};
+
+// --- ISA variants ---
+// The kernels below are compiled for several instruction sets with target
+// attributes, so the binary itself only assumes baseline x86-64. The best
+// variant the CPU supports is picked once at startup (simd_isa); set
+// SUDOKU_ISA=avx512|avx2|sse4.2|scalar to force a lower one for benchmarking.
+enum SimdIsa { ISA_SCALAR, ISA_SSE42, ISA_AVX2, ISA_AVX512, ISA_COUNT };
+static const char* const simd_isa_names[ISA_COUNT] = {"scalar", "sse4.2", "avx2", "avx512"};
+
+#define TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx2,popcnt")))
+
+// Portable variant, and the fallback for wide masks below AVX2
+template <int N>
+inline bool scan_board_scalar(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    scan.best_r = -1;
+    scan.best_count = N + 1;
+    bool ok = true;
+    for (int i = 0; i < N; i++) {
+        scan.singles[i] = 0;
+        for (int j = 0; j < N; j++) {
+            mask_t<N> mask = get_candidates(b, i, j);
+            scan.cand[i][j] = mask;
+            if (b.grid[i][j] != 0) continue;
+            int count = mask_popcount(mask);
+            if (count == 0) ok = false;
+            if (count == 1) scan.singles[i] |= 1ULL << j;
+            if (count < scan.best_count) {
+                scan.best_count = count;
+                scan.best_r = i;
+                scan.best_c = j;
+            }
+        }
+    }
+    return ok;
+}
+
+// --- 16-bit mask variants (N <= 16) ---
+// Byte shuffle that moves each column's box mask (2 bytes) out of the band
+// word. pshufb works per 128-bit half: bytes 0..15 serve columns 0..7 and
+// bytes 16..31 columns 8..15, with the band word broadcast to every half.
+template <int N>
+struct BoxShuffle {
+    alignas(32) int8_t idx[32];
+    BoxShuffle() {
+        for (int c = 0; c < 16; c++) {
+            int box = (c < N) ? c / sqrt_n<N> : 0;
+            idx[2 * c] = (int8_t)(2 * box);
+            idx[2 * c + 1] = (int8_t)(2 * box + 1);
         }
     }
+};
+template <int N> inline const BoxShuffle<N> box_shuffle{};
 
-    used |= h_or(v_used);
-    return used ^ ((1 << N) - 1);
+// The band's sqrt_n<N> box masks packed into one word
+template <int N>
+inline uint64_t band_box_word(const SudokuBoard<N>& b, int band) {
+    uint64_t word = 0;
+    memcpy(&word, &b.box_mask[band * sqrt_n<N>], sqrt_n<N> * sizeof(mask_t<N>));
+    return word;
 }
 
-inline bool propagate_simd(int grid[N][N]) {
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) {
-                if (grid[i][j] == 0) {
-                    int candidates = get_candidates_simd(grid, i, j);
-                    if (candidates == 0) return false;
-                    
-                    if ((candidates & (candidates - 1)) == 0) {
-                        int val = 0;
-                        while ((candidates & 1) == 0) {
-                            candidates >>= 1;
-                            val++;
-                        }
-                        grid[i][j] = val + 1;
-                        changed = true;
-                    }
-                }
+// Decode the minimum MRV key (count << 8 | r << 4 | c; 0xFFFF = board full)
+template <int N>
+inline void set_best(BoardScan<N>& scan, int key) {
+    if (key == 0xFFFF) {
+        scan.best_r = -1;
+    } else {
+        scan.best_r = (key >> 4) & 0xF;
+        scan.best_c = key & 0xF;
+        scan.best_count = key >> 8;
+    }
+}
+
+// --- SSE4.2: a row is two 8-lane halves ---
+TARGET_SSE42 inline __m128i popcount_epi16_sse(__m128i v) {
+    const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low4 = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, low4));
+    __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low4));
+    return _mm_maddubs_epi16(_mm_add_epi8(lo, hi), _mm_set1_epi8(1));
+}
+
+template <int N>
+TARGET_SSE42 inline bool scan_board_sse42(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    const __m128i full = _mm_set1_epi16((short)full_mask<N>);
+    const __m128i ones = _mm_set1_epi16(-1);
+    __m128i lane_idx[2], valid[2], v_col[2], shuffle[2], best[2];
+    alignas(16) mask_t<N> cols[16] = {0};
+    memcpy(cols, b.col_mask, N * sizeof(mask_t<N>));
+    for (int h = 0; h < 2; h++) {
+        lane_idx[h] = _mm_add_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16((short)(8 * h)));
+        valid[h] = _mm_cmpgt_epi16(_mm_set1_epi16(N), lane_idx[h]);
+        v_col[h] = _mm_load_si128((const __m128i*)(cols + 8 * h));
+        shuffle[h] = _mm_load_si128((const __m128i*)(box_shuffle<N>.idx + 16 * h));
+        best[h] = ones;
+    }
+
+    bool ok = true;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        __m128i v_band = _mm_set1_epi64x((long long)band_box_word(b, band));
+        __m128i v_colbox[2];
+        for (int h = 0; h < 2; h++) v_colbox[h] = _mm_or_si128(v_col[h], _mm_shuffle_epi8(v_band, shuffle[h]));
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m128i v_row = _mm_set1_epi16((short)b.row_mask[r]);
+            __m128i single[2];
+            for (int h = 0; h < 2; h++) {
+                __m128i v_cand = _mm_andnot_si128(_mm_or_si128(v_colbox[h], v_row), full);
+                _mm_store_si128((__m128i*)(scan.cand[r] + 8 * h), v_cand);
+
+                __m128i v_cells = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(b.grid[r] + 8 * h)));
+                __m128i v_empty = _mm_and_si128(_mm_cmpeq_epi16(v_cells, _mm_setzero_si128()), valid[h]);
+                __m128i v_count = popcount_epi16_sse(v_cand);
+
+                __m128i key = _mm_or_si128(_mm_slli_epi16(v_count, 8),
+                                           _mm_or_si128(_mm_set1_epi16((short)(r << 4)), lane_idx[h]));
+                best[h] = _mm_min_epu16(best[h], _mm_blendv_epi8(ones, key, v_empty));
+
+                __m128i v_zero = _mm_and_si128(_mm_cmpeq_epi16(v_count, _mm_setzero_si128()), v_empty);
+                if (!_mm_testz_si128(v_zero, v_zero)) ok = false;
+                single[h] = _mm_and_si128(_mm_cmpeq_epi16(v_count, _mm_set1_epi16(1)), v_empty);
             }
+            scan.singles[r] = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(single[0], single[1]));
         }
     }
-    return true;
+
+    set_best(scan, _mm_extract_epi16(_mm_minpos_epu16(_mm_min_epu16(best[0], best[1])), 0));
+    return ok;
 }
 
-inline bool solve_simd_serial(int grid[N][N]) {
-    int backup[N][N];
-    memcpy(backup, grid, sizeof(backup));
+// --- AVX2: a row is one 16-lane register ---
+// Per-lane popcount of 16-bit masks: nibble lookup, then add the byte pair
+TARGET_AVX2 inline __m256i popcount_epi16(__m256i v) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low4 = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low4));
+    __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+    return _mm256_maddubs_epi16(_mm256_add_epi8(lo, hi), _mm256_set1_epi8(1));
+}
 
-    if (!propagate_simd(grid)) {
-        memcpy(grid, backup, sizeof(backup));
-        return false;
+// One bit per 16-bit lane of a compare result
+TARGET_AVX2 inline uint32_t lane_bits_epi16(__m256i v) {
+    __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return (uint32_t)_mm_movemask_epi8(packed);
+}
+
+// Column masks of the whole board as 16 x 16-bit lanes. 16x16 fills the
+// register exactly; 9x9 (and 4x4) load only the lanes that exist.
+template <int N>
+TARGET_AVX2 inline __m256i load_col_masks(const SudokuBoard<N>& b) {
+    if constexpr (N == 16) {
+        return _mm256_loadu_si256((const __m256i*)b.col_mask);
+    } else {
+        __m256i v_lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i v_load = _mm256_cmpgt_epi32(_mm256_set1_epi32((N + 1) / 2), v_lanes);
+        return _mm256_maskload_epi32((const int*)b.col_mask, v_load);
     }
+}
 
-    int min_candidates = N + 1;
-    int best_r = -1, best_c = -1;
-    int best_mask = 0;
+// Box masks of band `band`, one per column lane
+template <int N>
+TARGET_AVX2 inline __m256i load_band_box_masks(const SudokuBoard<N>& b, int band) {
+    return _mm256_shuffle_epi8(_mm256_set1_epi64x((long long)band_box_word(b, band)),
+                               _mm256_load_si256((const __m256i*)box_shuffle<N>.idx));
+}
 
-    bool solved = true;
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            if (grid[i][j] == 0) {
-                solved = false;
-                int mask = get_candidates_simd(grid, i, j);
-                if (mask == 0) {
-                    memcpy(grid, backup, sizeof(backup));
-                    return false;
-                }
-                int count = 0;
-                int temp = mask;
-                while (temp) { temp &= (temp - 1); count++; }
-                if (count < min_candidates) {
-                    min_candidates = count;
-                    best_r = i;
-                    best_c = j;
-                    best_mask = mask;
-                }
+// Column masks are loaded once and box masks once per band; each row then
+// costs a broadcast, two ORs, a popcount and a min. Row r's lanes get the
+// MRV key, filled cells and lanes >= N get 0xFFFF, and a running
+// _mm256_min_epu16 plus one _mm_minpos_epu16 at the end yield the argmin.
+// For 9x9 each row uses lanes 0..8 and the rest are masked; for 16x16 every
+// lane is a cell.
+template <int N>
+TARGET_AVX2 inline bool scan_board_avx2(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    const __m256i full = _mm256_set1_epi16((short)full_mask<N>);
+    const __m256i ones = _mm256_set1_epi16(-1);
+    const __m256i lane_idx = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i valid = _mm256_cmpgt_epi16(_mm256_set1_epi16(N), lane_idx);
+
+    __m256i v_col = load_col_masks(b);
+    __m256i best = ones;
+    bool ok = true;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        __m256i v_colbox = _mm256_or_si256(v_col, load_band_box_masks(b, band));
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m256i v_used = _mm256_or_si256(v_colbox, _mm256_set1_epi16((short)b.row_mask[r]));
+            __m256i v_cand = _mm256_andnot_si256(v_used, full);
+            _mm256_store_si256((__m256i*)scan.cand[r], v_cand);
+
+            __m256i v_cells = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)b.grid[r]));
+            __m256i v_empty = _mm256_and_si256(_mm256_cmpeq_epi16(v_cells, _mm256_setzero_si256()), valid);
+            __m256i v_count = popcount_epi16(v_cand);
+
+            __m256i key = _mm256_or_si256(_mm256_slli_epi16(v_count, 8),
+                                          _mm256_or_si256(_mm256_set1_epi16((short)(r << 4)), lane_idx));
+            best = _mm256_min_epu16(best, _mm256_blendv_epi8(ones, key, v_empty));
+
+            __m256i v_zero = _mm256_and_si256(_mm256_cmpeq_epi16(v_count, _mm256_setzero_si256()), v_empty);
+            if (!_mm256_testz_si256(v_zero, v_zero)) ok = false;
+            scan.singles[r] = lane_bits_epi16(_mm256_and_si256(_mm256_cmpeq_epi16(v_count, _mm256_set1_epi16(1)), v_empty));
+        }
+    }
+
+    __m128i half = _mm_min_epu16(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    set_best(scan, _mm_extract_epi16(_mm_minpos_epu16(half), 0));
+    return ok;
+}
+
+// --- AVX-512: two rows per register, compares into mask registers ---
+// Lanes 0..15 hold row r and lanes 16..31 row r + 1, so a 16x16 row is one
+// 16-lane half and 9x9 takes five steps instead of nine. Compares produce
+// __mmask32 directly: the empty/valid masks, the singles bitmap and the
+// masked min need no blends or movemask packing.
+TARGET_AVX512 inline __m512i popcount_epi16_512(__m512i v) {
+    const __m512i lut = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low4 = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_shuffle_epi8(lut, _mm512_and_si512(v, low4));
+    __m512i hi = _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), low4));
+    return _mm512_maddubs_epi16(_mm512_add_epi8(lo, hi), _mm512_set1_epi8(1));
+}
+
+template <int N>
+TARGET_AVX512 inline bool scan_board_avx512(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    alignas(64) static const uint16_t iota[32] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                                  16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+    const __m512i full = _mm512_set1_epi16((short)full_mask<N>);
+    const __m512i lane_idx = _mm512_load_si512(iota);
+    const __mmask32 row_lanes = (uint32_t)full_mask<N> | ((uint32_t)full_mask<N> << 16);
+
+    // Column masks in both halves, box masks per band
+    __m256i v_col256 = load_col_masks(b);
+    __m512i v_col = _mm512_inserti64x4(_mm512_castsi256_si512(v_col256), v_col256, 1);
+    __m256i v_box[sqrt_n<N>];
+    for (int band = 0; band < sqrt_n<N>; band++) v_box[band] = load_band_box_masks(b, band);
+
+    __m512i best = _mm512_set1_epi16(-1);
+    __mmask32 dead = 0;
+    for (int r = 0; r < N; r += 2) {
+        bool pair = r + 1 < N;
+        __mmask32 valid = pair ? row_lanes : (row_lanes & 0xFFFF);
+        int r2 = pair ? r + 1 : r;
+
+        __m512i v_box2 = _mm512_inserti64x4(_mm512_castsi256_si512(v_box[r / sqrt_n<N>]), v_box[r2 / sqrt_n<N>], 1);
+        __m512i v_row = _mm512_inserti64x4(_mm512_set1_epi16((short)b.row_mask[r]),
+                                           _mm256_set1_epi16((short)b.row_mask[r2]), 1);
+        __m512i v_cand = _mm512_andnot_si512(_mm512_or_si512(v_row, _mm512_or_si512(v_col, v_box2)), full);
+        _mm512_mask_storeu_epi16(scan.cand[r], pair ? 0xFFFFFFFFu : 0xFFFFu, v_cand);
+
+        __m256i v_bytes;
+        if constexpr (N == 16) {
+            v_bytes = _mm256_loadu_si256((const __m256i*)b.grid[r]);
+        } else {
+            v_bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)b.grid[r])),
+                                              _mm_loadu_si128((const __m128i*)b.grid[r2]), 1);
+        }
+        __mmask32 empty = _mm512_cmpeq_epi16_mask(_mm512_cvtepu8_epi16(v_bytes), _mm512_setzero_si512()) & valid;
+        __m512i v_count = popcount_epi16_512(v_cand);
+
+        __m512i key = _mm512_or_si512(_mm512_slli_epi16(v_count, 8),
+                                      _mm512_add_epi16(_mm512_set1_epi16((short)(r << 4)), lane_idx));
+        best = _mm512_mask_min_epu16(best, empty, best, key);
+
+        dead |= _mm512_mask_cmpeq_epi16_mask(empty, v_count, _mm512_setzero_si512());
+        __mmask32 singles = _mm512_mask_cmpeq_epi16_mask(empty, v_count, _mm512_set1_epi16(1));
+        scan.singles[r] = singles & 0xFFFF;
+        if (pair) scan.singles[r + 1] = singles >> 16;
+    }
+
+    __m256i best256 = _mm256_min_epu16(_mm512_castsi512_si256(best), _mm512_extracti64x4_epi64(best, 1));
+    __m128i best128 = _mm_min_epu16(_mm256_castsi256_si128(best256), _mm256_extracti128_si256(best256, 1));
+    set_best(scan, _mm_extract_epi16(_mm_minpos_epu16(best128), 0));
+    return dead == 0;
+}
+
+// --- Wide masks (16 < N <= 64) ---
+// A row no longer fits one register, so it is walked in chunks of 32-bit
+// lanes (N <= 32, e.g. 25x25) or 64-bit lanes (N <= 64, e.g. 36x36). Per
+// band the box masks are expanded to one per column, so columns and boxes
+// are both plain loads. The MRV key is count << 16 | (r * N + c), with
+// 0xFFFFFFFF for filled cells.
+
+template <int N>
+inline void set_best_wide(BoardScan<N>& scan, uint64_t key) {
+    if (key >= 0xFFFFFFFFULL) {
+        scan.best_r = -1;
+    } else {
+        int cell = (int)(key & 0xFFFF);
+        scan.best_r = cell / N;
+        scan.best_c = cell % N;
+        scan.best_count = (int)(key >> 16);
+    }
+}
+
+template <int N>
+inline void expand_box_row(const SudokuBoard<N>& b, int band, mask_t<N> box_row[N]) {
+    for (int c = 0; c < N; c++) box_row[c] = b.box_mask[band * sqrt_n<N> + c / sqrt_n<N>];
+}
+
+// Per-lane popcount of 32-bit masks: byte counts, then two pairwise adds
+TARGET_AVX2 inline __m256i popcount_epi32(__m256i v) {
+    __m256i bytes = popcount_epi16(v); // pairs of bytes already summed into 16 bits
+    return _mm256_madd_epi16(bytes, _mm256_set1_epi16(1));
+}
+
+// Per-lane popcount of 64-bit masks: byte counts summed by psadbw
+TARGET_AVX2 inline __m256i popcount_epi64(__m256i v) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low4 = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low4));
+    __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+// AVX2, 8 x 32-bit lanes per chunk
+template <int N>
+TARGET_AVX2 inline bool scan_board_w32_avx2(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    static_assert(sizeof(mask_t<N>) == 4, "32-bit masks");
+    static_assert(sizeof(SudokuBoard<N>) >= N * N + 8, "cell loads may read 8 bytes past the last row");
+    const __m256i full = _mm256_set1_epi32((int)full_mask<N>);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    alignas(32) mask_t<N> box_row[N];
+
+    __m256i best = ones;
+    bool ok = true;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        expand_box_row(b, band, box_row);
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m256i v_row = _mm256_set1_epi32((int)b.row_mask[r]);
+            uint64_t singles = 0;
+            for (int c0 = 0; c0 < N; c0 += 8) {
+                __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(N - c0), lane_idx);
+                __m256i v_col = _mm256_maskload_epi32((const int*)(b.col_mask + c0), valid);
+                __m256i v_box = _mm256_maskload_epi32((const int*)(box_row + c0), valid);
+                __m256i v_cand = _mm256_andnot_si256(_mm256_or_si256(v_row, _mm256_or_si256(v_col, v_box)), full);
+                _mm256_maskstore_epi32((int*)(scan.cand[r] + c0), valid, v_cand);
+
+                __m256i v_cells = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(b.grid[r] + c0)));
+                __m256i v_empty = _mm256_and_si256(_mm256_cmpeq_epi32(v_cells, _mm256_setzero_si256()), valid);
+                __m256i v_count = popcount_epi32(v_cand);
+
+                __m256i key = _mm256_or_si256(_mm256_slli_epi32(v_count, 16),
+                                              _mm256_add_epi32(_mm256_set1_epi32(r * N + c0), lane_idx));
+                best = _mm256_min_epu32(best, _mm256_blendv_epi8(ones, key, v_empty));
+
+                __m256i v_zero = _mm256_and_si256(_mm256_cmpeq_epi32(v_count, _mm256_setzero_si256()), v_empty);
+                if (!_mm256_testz_si256(v_zero, v_zero)) ok = false;
+                __m256i v_single = _mm256_and_si256(_mm256_cmpeq_epi32(v_count, _mm256_set1_epi32(1)), v_empty);
+                singles |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(v_single)) << c0;
+            }
+            scan.singles[r] = singles;
+        }
+    }
+
+    __m128i m = _mm_min_epu32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0x4E));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0xB1));
+    set_best_wide(scan, (uint32_t)_mm_cvtsi128_si32(m));
+    return ok;
+}
+
+// AVX2, 4 x 64-bit lanes per chunk. There is no unsigned 64-bit min, but the
+// keys stay below 2^63, so a signed compare and a blend do the same job.
+template <int N>
+TARGET_AVX2 inline bool scan_board_w64_avx2(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    static_assert(sizeof(mask_t<N>) == 8, "64-bit masks");
+    static_assert(sizeof(SudokuBoard<N>) >= N * N + 4, "cell loads may read 4 bytes past the last row");
+    const __m256i full = _mm256_set1_epi64x((long long)full_mask<N>);
+    const __m256i none = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    const __m256i lane_idx = _mm256_setr_epi64x(0, 1, 2, 3);
+    alignas(32) mask_t<N> box_row[N];
+
+    __m256i best = none;
+    bool ok = true;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        expand_box_row(b, band, box_row);
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m256i v_row = _mm256_set1_epi64x((long long)b.row_mask[r]);
+            uint64_t singles = 0;
+            for (int c0 = 0; c0 < N; c0 += 4) {
+                __m256i valid = _mm256_cmpgt_epi64(_mm256_set1_epi64x(N - c0), lane_idx);
+                __m256i v_col = _mm256_maskload_epi64((const long long*)(b.col_mask + c0), valid);
+                __m256i v_box = _mm256_maskload_epi64((const long long*)(box_row + c0), valid);
+                __m256i v_cand = _mm256_andnot_si256(_mm256_or_si256(v_row, _mm256_or_si256(v_col, v_box)), full);
+                _mm256_maskstore_epi64((long long*)(scan.cand[r] + c0), valid, v_cand);
+
+                int cells4;
+                memcpy(&cells4, b.grid[r] + c0, 4);
+                __m256i v_cells = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(cells4));
+                __m256i v_empty = _mm256_and_si256(_mm256_cmpeq_epi64(v_cells, _mm256_setzero_si256()), valid);
+                __m256i v_count = popcount_epi64(v_cand);
+
+                __m256i key = _mm256_or_si256(_mm256_slli_epi64(v_count, 16),
+                                              _mm256_add_epi64(_mm256_set1_epi64x(r * N + c0), lane_idx));
+                key = _mm256_blendv_epi8(none, key, v_empty);
+                best = _mm256_blendv_epi8(best, key, _mm256_cmpgt_epi64(best, key));
+
+                __m256i v_zero = _mm256_and_si256(_mm256_cmpeq_epi64(v_count, _mm256_setzero_si256()), v_empty);
+                if (!_mm256_testz_si256(v_zero, v_zero)) ok = false;
+                __m256i v_single = _mm256_and_si256(_mm256_cmpeq_epi64(v_count, _mm256_set1_epi64x(1)), v_empty);
+                singles |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(v_single)) << c0;
             }
+            scan.singles[r] = singles;
         }
     }
 
-    if (solved) return true;
+    alignas(32) uint64_t keys[4];
+    _mm256_store_si256((__m256i*)keys, best);
+    set_best_wide(scan, min(min(keys[0], keys[1]), min(keys[2], keys[3])));
+    return ok;
+}
+
+// AVX-512, 16 x 32-bit or 8 x 64-bit lanes per chunk. Loads, stores and
+// compares are masked to the row's remaining columns, so the tail chunk
+// needs no padding.
+TARGET_AVX512 inline __m512i popcount_bytes_512(__m512i v) {
+    const __m512i lut = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low4 = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_shuffle_epi8(lut, _mm512_and_si512(v, low4));
+    __m512i hi = _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), low4));
+    return _mm512_add_epi8(lo, hi);
+}
 
-    for (int val = 1; val <= N; val++) {
-        if (best_mask & (1 << (val - 1))) {
-            grid[best_r][best_c] = val;
-            if (solve_simd_serial(grid)) return true;
+template <int N>
+TARGET_AVX512 inline bool scan_board_w32_avx512(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    static_assert(sizeof(mask_t<N>) == 4, "32-bit masks");
+    const __m512i full = _mm512_set1_epi32((int)full_mask<N>);
+    const __m512i lane_idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    alignas(64) mask_t<N> box_row[N];
+
+    __m512i best = _mm512_set1_epi32(-1);
+    __mmask16 dead = 0;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        expand_box_row(b, band, box_row);
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m512i v_row = _mm512_set1_epi32((int)b.row_mask[r]);
+            uint64_t singles = 0;
+            for (int c0 = 0; c0 < N; c0 += 16) {
+                __mmask16 valid = (__mmask16)(N - c0 >= 16 ? 0xFFFF : (1u << (N - c0)) - 1);
+                __m512i v_col = _mm512_maskz_loadu_epi32(valid, b.col_mask + c0);
+                __m512i v_box = _mm512_maskz_loadu_epi32(valid, box_row + c0);
+                __m512i v_cand = _mm512_andnot_si512(_mm512_or_si512(v_row, _mm512_or_si512(v_col, v_box)), full);
+                _mm512_mask_storeu_epi32(scan.cand[r] + c0, valid, v_cand);
+
+                __m512i v_cells = _mm512_cvtepu8_epi32(_mm_maskz_loadu_epi8(valid, b.grid[r] + c0));
+                __mmask16 empty = _mm512_mask_cmpeq_epi32_mask(valid, v_cells, _mm512_setzero_si512());
+                __m512i v_count = _mm512_madd_epi16(_mm512_maddubs_epi16(popcount_bytes_512(v_cand), _mm512_set1_epi8(1)),
+                                                    _mm512_set1_epi16(1));
+
+                __m512i key = _mm512_or_si512(_mm512_slli_epi32(v_count, 16),
+                                              _mm512_add_epi32(_mm512_set1_epi32(r * N + c0), lane_idx));
+                best = _mm512_mask_min_epu32(best, empty, best, key);
+                dead |= _mm512_mask_cmpeq_epi32_mask(empty, v_count, _mm512_setzero_si512());
+                singles |= (uint64_t)_mm512_mask_cmpeq_epi32_mask(empty, v_count, _mm512_set1_epi32(1)) << c0;
+            }
+            scan.singles[r] = singles;
         }
     }
 
-    memcpy(grid, backup, sizeof(backup)); 
+    set_best_wide(scan, (uint32_t)_mm512_reduce_min_epu32(best));
+    return dead == 0;
+}
+
+template <int N>
+TARGET_AVX512 inline bool scan_board_w64_avx512(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    static_assert(sizeof(mask_t<N>) == 8, "64-bit masks");
+    const __m512i full = _mm512_set1_epi64((long long)full_mask<N>);
+    const __m512i lane_idx = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    alignas(64) mask_t<N> box_row[N];
+
+    __m512i best = _mm512_set1_epi64(0xFFFFFFFFLL);
+    __mmask8 dead = 0;
+    for (int band = 0; band < sqrt_n<N>; band++) {
+        expand_box_row(b, band, box_row);
+        for (int r = band * sqrt_n<N>; r < (band + 1) * sqrt_n<N>; r++) {
+            __m512i v_row = _mm512_set1_epi64((long long)b.row_mask[r]);
+            uint64_t singles = 0;
+            for (int c0 = 0; c0 < N; c0 += 8) {
+                __mmask8 valid = (__mmask8)(N - c0 >= 8 ? 0xFF : (1u << (N - c0)) - 1);
+                __m512i v_col = _mm512_maskz_loadu_epi64(valid, b.col_mask + c0);
+                __m512i v_box = _mm512_maskz_loadu_epi64(valid, box_row + c0);
+                __m512i v_cand = _mm512_andnot_si512(_mm512_or_si512(v_row, _mm512_or_si512(v_col, v_box)), full);
+                _mm512_mask_storeu_epi64(scan.cand[r] + c0, valid, v_cand);
+
+                __m512i v_cells = _mm512_cvtepu8_epi64(_mm_maskz_loadu_epi8(valid, b.grid[r] + c0));
+                __mmask8 empty = _mm512_mask_cmpeq_epi64_mask(valid, v_cells, _mm512_setzero_si512());
+                __m512i v_count = _mm512_sad_epu8(popcount_bytes_512(v_cand), _mm512_setzero_si512());
+
+                __m512i key = _mm512_or_si512(_mm512_slli_epi64(v_count, 16),
+                                              _mm512_add_epi64(_mm512_set1_epi64(r * N + c0), lane_idx));
+                best = _mm512_mask_min_epu64(best, empty, best, key);
+                dead |= _mm512_mask_cmpeq_epi64_mask(empty, v_count, _mm512_setzero_si512());
+                singles |= (uint64_t)_mm512_mask_cmpeq_epi64_mask(empty, v_count, _mm512_set1_epi64(1)) << c0;
+            }
+            scan.singles[r] = singles;
+        }
+    }
+
+    set_best_wide(scan, (uint64_t)_mm512_reduce_min_epu64(best));
+    return dead == 0;
+}
+
+// Best variant this CPU runs; they are nested, so anything below it works too
+inline SimdIsa best_supported_isa() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) return ISA_AVX512;
+    if (__builtin_cpu_supports("avx2")) return ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return ISA_SSE42;
+    return ISA_SCALAR;
+}
+
+inline SimdIsa select_simd_isa() {
+    SimdIsa best = best_supported_isa();
+    const char* forced = getenv("SUDOKU_ISA");
+    if (forced == nullptr) return best;
+    for (int i = 0; i < ISA_COUNT; i++) {
+        if (strcmp(forced, simd_isa_names[i]) != 0) continue;
+        if (i <= best) return (SimdIsa)i;
+        cerr << "SUDOKU_ISA=" << forced << " is not available here, using " << simd_isa_names[best] << endl;
+        return best;
+    }
+    cerr << "Unknown SUDOKU_ISA=" << forced << ", using " << simd_isa_names[best] << endl;
+    return best;
+}
+
+inline const SimdIsa simd_isa = select_simd_isa();
+
+// Whole-board scan: every cell's candidates, the empty cells with one
+// candidate, and the MRV cell. Up to 16x16 a row is one register; wider
+// boards use the 32- or 64-bit lane kernels. Returns false if an empty cell
+// has no candidates.
+template <int N>
+inline bool scan_board_simd(const SudokuBoard<N>& b, BoardScan<N>& scan) {
+    if constexpr (N <= 16) {
+        static_assert(sizeof(SudokuBoard<N>) >= N * N + 16, "row loads may read 16 bytes past the last row");
+        switch (simd_isa) {
+        case ISA_AVX512: return scan_board_avx512(b, scan);
+        case ISA_AVX2: return scan_board_avx2(b, scan);
+        case ISA_SSE42: return scan_board_sse42(b, scan);
+        default: break;
+        }
+    } else if constexpr (N <= 32) {
+        if (simd_isa == ISA_AVX512) return scan_board_w32_avx512(b, scan);
+        if (simd_isa == ISA_AVX2) return scan_board_w32_avx2(b, scan);
+    } else {
+        if (simd_isa == ISA_AVX512) return scan_board_w64_avx512(b, scan);
+        if (simd_isa == ISA_AVX2) return scan_board_w64_avx2(b, scan);
+    }
+    return scan_board_scalar(b, scan);
+}
+
+// Naked singles to a fixpoint, rescanning the whole board after each round.
+// A single whose value was taken by an earlier placement in the same round
+// has no candidates left, which is a contradiction. On success, scan holds
+// the final board's candidates and MRV cell.
+template <int N>
+inline bool propagate_simd(SudokuBoard<N>& b, trail_ptr<N> trail, BoardScan<N>& scan) {
+    while (true) {
+        if (!scan_board_simd(b, scan)) return false;
+        bool placed = false;
+        for (int i = 0; i < N; i++) {
+            uint64_t todo = scan.singles[i];
+            while (todo) {
+                int j = mask_ctz(todo);
+                todo &= todo - 1;
+                mask_t<N> bit = scan.cand[i][j];
+                if ((get_candidates(b, i, j) & bit) == 0) return false;
+                place(b, trail, i, j, mask_ctz(bit) + 1);
+                thread_prop_stats().fired[RULE_NAKED_SINGLE]++;
+                placed = true;
+            }
+        }
+        if (!placed) return true;
+    }
+}
+
+template <int N>
+inline bool propagate_simd(SudokuBoard<N>& b, trail_ptr<N> trail = nullptr) {
+    BoardScan<N> scan;
+    return propagate_simd(b, trail, scan);
+}
+
+// MRV over the empty cells. Returns false if some cell has no candidates;
+// otherwise best_r is -1 when the board is full.
+template <int N>
+inline bool find_mrv_simd(const SudokuBoard<N>& b, int& best_r, int& best_c, mask_t<N>& best_mask) {
+    BoardScan<N> scan;
+    if (!scan_board_simd(b, scan)) return false;
+    best_r = scan.best_r;
+    if (best_r != -1) {
+        best_c = scan.best_c;
+        best_mask = scan.cand[best_r][best_c];
+    }
+    return true;
+}
+
+// One search node on the SIMD path: propagate, then pick the branching cell.
+// Rules above naked singles (prop_level > 0) run on the scalar candidate grid.
+template <int N>
+inline bool propagate_and_pick_simd(SudokuBoard<N>& b, trail_ptr<N> trail, int& best_r, int& best_c, mask_t<N>& best_mask) {
+    thread_prop_stats().nodes++;
+    BoardScan<N> scan;
+    if (!propagate_simd(b, trail, scan)) return false;
+    if (active_prop_level() == 0) {
+        // The last propagation scan already holds the MRV cell
+        best_r = scan.best_r;
+        if (best_r != -1) {
+            best_c = scan.best_c;
+            best_mask = scan.cand[best_r][best_c];
+        }
+        return true;
+    }
+
+    mask_t<N> cand[N][N];
+    fill_candidates(b, cand);
+    if (!propagate_rules(b, trail, cand)) return false;
+    return find_mrv(b, cand, best_r, best_c, best_mask);
+}
+
+// Same contract as solve_serial, including the cancel token
+template <int N>
+inline bool solve_simd_serial(SudokuBoard<N>& b, Trail<N>& trail, const CancelToken* cancel = nullptr) {
+    if (cancel && cancel->cancelled()) return false;
+    int mark = trail.size;
+
+    int best_r = -1, best_c = -1;
+    mask_t<N> best_mask = 0;
+    if (!propagate_and_pick_simd(b, &trail, best_r, best_c, best_mask)) {
+        undo_to(b, trail, mark);
+        return false;
+    }
+
+    if (best_r == -1) return true;
+
+    int values[N];
+    int count = order_values(b, best_r, best_c, best_mask, value_order, values);
+    for (int k = 0; k < count; k++) {
+        place(b, best_r, best_c, values[k]);
+        if (solve_simd_serial(b, trail, cancel)) return true;
+        unplace(b, best_r, best_c);
+    }
+
+    undo_to(b, trail, mark);
     return false;
 }
+
+template <int N>
+inline bool solve_simd_serial(SudokuBoard<N>& b, const CancelToken* cancel = nullptr) {
+    Trail<N> trail;
+    return solve_simd_serial(b, trail, cancel);
+}
+
+// Grid-level entry point: build the masks, solve, and copy the solution back
+template <int N>
+inline bool solve_simd_grid(int grid[N][N]) {
+    SudokuBoard<N> b;
+    if (!init_board(b, grid)) return false;
+    if (!solve_simd_serial(b)) return false;
+    board_to_grid(b, grid);
+    return true;
+}
 // --- SIMD Helpers End ---
 
 #endif
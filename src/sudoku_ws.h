@@ -0,0 +1,245 @@
+#ifndef SUDOKU_WS_H
+#define SUDOKU_WS_H
+
+#include <omp.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include "sudoku_common.h"
+
+// --- Work-stealing search for one puzzle (--sched ws) ---
+// Each OpenMP thread runs a plain depth-first search with a trail and an
+// explicit stack of branch frames, and owns a deque of tasks. Nothing is
+// split up front: at every node a worker reads one shared counter, and only
+// when some thread is idle (and its own deque is empty) does it hand off the
+// untried values of its oldest frame, the biggest subtree it knows of. Idle
+// threads steal the oldest task of another deque; owners pop their newest.
+// With every thread busy the search costs what the row-major trail search
+// (propagate_and_pick with a trail, no MRV buckets) costs.
+//
+// A task is a board plus, optionally, the cell to branch on and the values
+// left to try there. Values are tried in value_order; a frame keeps its
+// ordered list, and a task's board is the node's own board, so ordering the
+// handed-off mask again gives the same sequence.
+//
+// pending counts tasks queued or running; the search ends when it drops to
+// zero or a solution is published.
+
+template <int N>
+struct WsTask {
+    SudokuBoard<N> board;
+    int r = -1, c = -1;   // r == -1: expand the board as a new node
+    mask_t<N> rest = 0;   // values still to try at (r, c)
+};
+
+// Pick must behave like propagate_and_pick: propagate, log writes to the
+// trail, and return the MRV cell (best_r == -1 when solved). One search
+// object is meant to serve many puzzles (see ws_search), so the workers and
+// their deques are allocated once, not per solve.
+template <int N, class Pick>
+class WorkStealingSearch {
+public:
+    // Solve b in place; returns false if the puzzle has no solution
+    bool solve(SudokuBoard<N>& b, Pick pick) {
+        this->pick = pick;
+        done.reset();
+        idle = 0;
+        pending = 1;
+        #pragma omp parallel
+        {
+            int self = omp_get_thread_num();
+            #pragma omp single
+            workers.resize(omp_get_num_threads());
+            // Each thread allocates its own worker on its first solve, so with
+            // pinned threads the deque lives on the thread's NUMA node (first
+            // touch). Tasks left over when the last solve ended are dropped.
+            if (!workers[self]) workers[self].reset(new Worker);
+            workers[self]->tasks.clear();
+            workers[self]->queued = 0;
+            #pragma omp barrier
+            #pragma omp single
+            {
+                workers[0]->tasks.push_back(WsTask<N>{b});
+                workers[0]->queued = 1;
+            }
+            work(self);
+        }
+        record_quiescence(done);
+        if (!done.cancelled()) return false;
+        b = solution;
+        return true;
+    }
+
+private:
+    struct alignas(64) Worker {
+        mutex lock;
+        deque<WsTask<N>> tasks;
+        atomic<int> queued{0};
+    };
+
+    struct Frame {
+        int mark;           // trail size after this node's propagation
+        int r, c;
+        int next, count;    // values[next..count) are still to try
+        uint8_t values[N];  // the node's candidates in value_order
+    };
+
+    Pick pick;
+    vector<unique_ptr<Worker>> workers;
+    CancelToken done;       // fired by the first solution
+    atomic<int> idle{0};
+    atomic<int> pending{0};
+    SudokuBoard<N> solution;
+
+    void open_frame(Frame& f, const SudokuBoard<N>& b, int mark, int r, int c, mask_t<N> mask) {
+        int values[N];
+        f.mark = mark;
+        f.r = r;
+        f.c = c;
+        f.next = 0;
+        f.count = order_values(b, r, c, mask, value_order, values);
+        for (int k = 0; k < f.count; k++) f.values[k] = (uint8_t)values[k];
+    }
+
+    void push(int self, const WsTask<N>& t) {
+        Worker& w = *workers[self];
+        lock_guard<mutex> guard(w.lock);
+        w.tasks.push_back(t);
+        w.queued++;
+    }
+
+    // Own tasks from the back (depth first), stolen ones from the front
+    bool take(Worker& w, WsTask<N>& t, bool oldest) {
+        if (w.queued.load(memory_order_relaxed) == 0) return false;
+        lock_guard<mutex> guard(w.lock);
+        if (w.tasks.empty()) return false;
+        if (oldest) {
+            t = w.tasks.front();
+            w.tasks.pop_front();
+        } else {
+            t = w.tasks.back();
+            w.tasks.pop_back();
+        }
+        w.queued--;
+        return true;
+    }
+
+    bool steal(int self, WsTask<N>& t) {
+        int n = (int)workers.size();
+        for (int k = 1; k < n; k++) {
+            if (take(*workers[(self + k) % n], t, true)) return true;
+        }
+        return false;
+    }
+
+    void work(int self) {
+        bool waiting = false;
+        WsTask<N> t;
+        while (!done.cancelled() && pending.load(memory_order_acquire) > 0) {
+            if (take(*workers[self], t, false) || steal(self, t)) {
+                if (waiting) {
+                    idle--;
+                    waiting = false;
+                }
+                run(self, t);
+                pending--;
+            } else if (!waiting) {
+                idle++;
+                waiting = true;
+            } else {
+                this_thread::yield();
+            }
+        }
+        if (waiting) idle--;
+    }
+
+    // Hand the untried values of the oldest open frame to the idle threads.
+    // The task's board is the current one with the trail rolled back to that
+    // frame, done on a copy so the search itself is not disturbed.
+    void split(int self, const SudokuBoard<N>& b, const Trail<N>& trail, Frame* frames, int depth) {
+        for (int i = 0; i < depth; i++) {
+            Frame& f = frames[i];
+            if (f.next == f.count) continue;
+
+            WsTask<N> t;
+            t.board = b;
+            for (int k = trail.size - 1; k >= f.mark; k--) {
+                unplace(t.board, trail.cells[k] / N, trail.cells[k] % N);
+            }
+            t.r = f.r;
+            t.c = f.c;
+            for (int k = f.next; k < f.count; k++) t.rest |= digit_bit<N>(f.values[k]);
+            f.next = f.count;
+            pending++;
+            push(self, t);
+            return;
+        }
+    }
+
+    void publish(const SudokuBoard<N>& b) {
+        if (done.cancel()) solution = b;
+    }
+
+    // Depth-first search of one task, the same order as the row-major trail
+    // search; solve_serial at prop_level 0 uses MRV buckets and breaks ties
+    // differently
+    void run(int self, const WsTask<N>& t) {
+        SudokuBoard<N> b = t.board;
+        Trail<N> trail;
+        Frame frames[N * N + 1];
+        int depth = 0;
+        bool expand = true;
+        if (t.r != -1) {
+            open_frame(frames[depth++], b, 0, t.r, t.c, t.rest);
+            expand = false;
+        }
+
+        while (true) {
+            if (expand) {
+                if (done.cancelled()) return;
+                if (idle.load(memory_order_relaxed) > 0 && workers[self]->queued.load(memory_order_relaxed) == 0) {
+                    split(self, b, trail, frames, depth);
+                }
+
+                int best_r = -1, best_c = -1;
+                mask_t<N> best_mask = 0;
+                if (pick(b, &trail, best_r, best_c, best_mask)) {
+                    if (best_r == -1) {
+                        publish(b);
+                        return;
+                    }
+                    open_frame(frames[depth++], b, trail.size, best_r, best_c, best_mask);
+                }
+                // On a contradiction the next branch's undo_to clears the
+                // node's partial propagation.
+            }
+
+            while (depth > 0 && frames[depth - 1].next == frames[depth - 1].count) depth--;
+            if (depth == 0) return;
+            Frame& f = frames[depth - 1];
+            undo_to(b, trail, f.mark);
+            place(b, &trail, f.r, f.c, f.values[f.next++]);
+            expand = true;
+        }
+    }
+};
+
+// One search per board size and calling thread, kept across puzzles
+template <int N, class Pick>
+inline WorkStealingSearch<N, Pick>& ws_search() {
+    thread_local WorkStealingSearch<N, Pick> search;
+    return search;
+}
+
+// Grid-level entry point, like solve_grid_serial
+template <int N, class Pick>
+inline bool solve_grid_ws(int grid[N][N], Pick pick) {
+    SudokuBoard<N> b;
+    if (!init_board(b, grid)) return false;
+    if (!ws_search<N, Pick>().solve(b, pick)) return false;
+    board_to_grid(b, grid);
+    return true;
+}
+
+#endif